@@ -55,16 +55,104 @@
 #define pgm_read_byte(addr)                                                    \
   (*(const unsigned char *)(addr)) //!< Reads byte from address
 #endif
+#ifndef PROGMEM
+#define PROGMEM //!< Plain const data on targets without a separate flash space
+#endif
 #include <stdlib.h>
+#include <string.h>
 
 #include <Adafruit_SI5351.h>
 
+#ifdef SI5351_ENABLE_STATS
+#define SI5351_STATS_SCOPE(api)                                                \
+  StatsScope statsScope(this, api) //!< Charges bus traffic to api
+#else
+#define SI5351_STATS_SCOPE(api) //!< Compiled out without SI5351_ENABLE_STATS
+#endif
+
+/* Test setup from SI5351 ClockBuilder
+ * -----------------------------------
+ * XTAL:      25     MHz
+ * Channel 0: 120.00 MHz
+ * Channel 1: 12.00  MHz
+ * Channel 2: 13.56  MHz
+ */
+static const uint8_t m_si5351_clockbuilder_map[] PROGMEM = {
+    /* Registers 15..92 */
+    15, 78,
+    0x00, /* Input source = crystal for PLLA and PLLB */
+    0x4F, /* CLK0 Control: 8mA drive, Multisynth 0 as CLK0 source, Clock
+              not inverted, Source = PLLA, Multisynth 0 in integer mode,
+              clock powered up */
+    0x4F, /* CLK1 Control: 8mA drive, Multisynth 1 as CLK1 source, Clock
+              not inverted, Source = PLLA, Multisynth 1 in integer mode,
+              clock powered up */
+    0x6F, /* CLK2 Control: 8mA drive, Multisynth 2 as CLK2 source, Clock
+              not inverted, Source = PLLB, Multisynth 2 in integer mode,
+              clock powered up */
+    0x80, /* CLK3 Control: Not used ... clock powered down */
+    0x80, /* CLK4 Control: Not used ... clock powered down */
+    0x80, /* CLK5 Control: Not used ... clock powered down */
+    0x80, /* CLK6 Control: Not used ... clock powered down */
+    0x80, /* CLK7 Control: Not used ... clock powered down */
+    0x00, /* Clock disable state 0..3 (low when disabled) */
+    0x00, /* Clock disable state 4..7 (low when disabled) */
+    /* PLL_A Setup */
+    0x00, 0x05, 0x00, 0x0C, 0x66, 0x00, 0x00, 0x02,
+    /* PLL_B Setup */
+    0x02, 0x71, 0x00, 0x0C, 0x1A, 0x00, 0x00, 0x86,
+    /* Multisynth 0 Setup */
+    0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    /* Multisynth 1 Setup */
+    0x00, 0x01, 0x00, 0x1C, 0x00, 0x00, 0x00, 0x00,
+    /* Multisynth 2 Setup */
+    0x00, 0x01, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00,
+    /* Multisynth 3..5 Setup (unused) */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //
+    /* Multisynth 6/7 and their output dividers (unused) */
+    0x00, 0x00, 0x00,
+    /* Misc Config Register, registers 149..170 */
+    149, 22,
+    /* Spread spectrum parameters (149..161) */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //
+    0x00, 0x00, 0x00, 0x00, 0x00,                   //
+    /* VCXO parameters (162..164) */
+    0x00, 0x00, 0x00,
+    /* CLK0..CLK5 initial phase offset (165..170) */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    SI5351_MAP_END};
+
+/* Register blocks read by syncFromDevice(), snapshot(), verify() and a warm
+   begin() (start address, length). 177..183 is a single read, the reserved
+   registers in between cost less than a second transaction. */
+static const uint8_t m_si5351_sync_ranges[][2] = {
+    {2, 2}, {9, 1}, {15, 78}, {149, 22}, {177, 7}};
+
+/* Register blocks savePlan() stores (start address, length) */
+static const uint8_t m_si5351_plan_ranges[][2] = {
+    {2, 2}, {9, 1}, {15, 78}, {149, 22}, {183, 1}, {187, 1}};
+
+/* Saved plan layout: magic, version, little-endian blob length, crystal
+   frequency, PPM, PLL A/B frequencies, crystal calibration, crystal load,
+   PLL flags, then the register map and the CRC-16 of everything before
+   it */
+#define SI5351_PLAN_MAGIC_0 (0x53) /* 'S' */
+#define SI5351_PLAN_MAGIC_1 (0x35) /* '5' */
+#define SI5351_PLAN_HEADER (27)
+
+/* Set from the INTR pin interrupt, cleared by poll() */
+static volatile bool m_si5351Interrupt = false;
+
+static void si5351InterruptHandler(void) { m_si5351Interrupt = true; }
+
 /**************************************************************************/
 /*!
     Constructor
 */
 /**************************************************************************/
-Adafruit_SI5351::Adafruit_SI5351(void) {
+Adafruit_SI5351::Adafruit_SI5351(void) : m_i2cDevice(SI5351_ADDRESS, &Wire) {
   m_si5351Config.initialised = false;
   m_si5351Config.crystalFreq = SI5351_CRYSTAL_FREQ_25MHZ;
   m_si5351Config.crystalLoad = SI5351_CRYSTAL_LOAD_10PF;
@@ -73,10 +161,38 @@ Adafruit_SI5351::Adafruit_SI5351(void) {
   m_si5351Config.plla_freq = 0;
   m_si5351Config.pllb_configured = false;
   m_si5351Config.pllb_freq = 0;
+  m_si5351Config.crystalPPB = 0;
+  m_fastRetune = false;
+  m_fineX[0] = m_fineX[1] = 0;
+  m_sweep.active = false;
+  m_inTransaction = false;
+  m_txDisableOutputs = false;
+  m_txWriteOE = false;
+  m_txOE = 0;
+  m_pendingReset = 0;
+  memset(m_regDirty, 0, sizeof(m_regDirty));
+  m_async = false;
+  m_writeCallback = NULL;
+  m_queueHead = 0;
+  m_queueCount = 0;
+  m_requestPending = 0;
+  m_intPin = -1;
+  m_statusCallback = NULL;
 
-  for (uint8_t i = 0; i < 3; i++) {
-    lastRdivValue[i] = 0;
-  }
+#ifdef SI5351_ENABLE_STATS
+  m_statsApi = SI5351_STATS_OTHER;
+  m_lockPending = 0;
+  resetStats();
+#endif
+
+  invalidateCache();
+  memset(m_regVolatile, 0, sizeof(m_regVolatile));
+
+  /* Status registers change under our feet, and the PLL reset bits
+     self-clear, so these are always read from the device */
+  setRegisterVolatile(SI5351_REGISTER_0_DEVICE_STATUS, true);
+  setRegisterVolatile(SI5351_REGISTER_1_INTERRUPT_STATUS_STICKY, true);
+  setRegisterVolatile(SI5351_REGISTER_177_PLL_RESET, true);
 }
 
 /**************************************************************************/
@@ -85,28 +201,76 @@ Adafruit_SI5351::Adafruit_SI5351(void) {
    before doing anything else)
 
     @param  theWire The I2C (Wire) bus to use.
+    @param  addr    The 7-bit I2C address (0x60, or 0x61 with ADDR high)
+    @param  plan    Optional register map (see loadRegisterMap()) the
+                    device may already be running, for a warm boot
+    @param  warm    Set to true if the plan was found running and kept
+
+    Without a plan, all outputs are disabled and powered down, ready to
+    be configured. With a plan, the live configuration (registers 2..3,
+    9, 15..92, 149..170 and 177..183) is burst-read first. If every one of
+    those registers that the plan sets matches, as after a reset of the
+    MCU only, the device is left untouched so its clocks keep running and
+    the PLL state is restored from the registers. Otherwise the device is
+    initialised as without a plan and *warm is false, so the caller knows
+    to apply its configuration again.
 */
 /**************************************************************************/
-err_t Adafruit_SI5351::begin(TwoWire *theWire) {
-  /* Initialise I2C */
-  if (i2c_dev)
-    delete i2c_dev;
-  i2c_dev = new Adafruit_I2CDevice(SI5351_ADDRESS, theWire);
+err_t Adafruit_SI5351::begin(TwoWire *theWire, uint8_t addr,
+                             const uint8_t *plan, bool *warm) {
+  SI5351_STATS_SCOPE(SI5351_STATS_BEGIN);
+
+  if (warm)
+    *warm = false;
+
+  /* Initialise I2C, reusing the same storage on every re-init */
+  m_i2cDevice = Adafruit_I2CDevice(addr, theWire);
+  i2c_dev = &m_i2cDevice;
   if (!i2c_dev->begin())
     return ERROR_I2C_DEVICENOTFOUND;
 
+  /* Whatever we knew about the register map no longer applies */
+  invalidateCache();
+  m_inTransaction = false;
+  m_pendingReset = 0;
+  memset(m_regDirty, 0, sizeof(m_regDirty));
+  m_queueCount = 0;
+  m_requestPending = 0;
+  m_sweep.active = false;
+
+  if (plan) {
+    ASSERT_STATUS(readRanges());
+
+    if (planMatches(plan)) {
+      /* Warm boot: rebuild what setupPLL() recorded, touching nothing */
+      for (uint8_t p = 0; p < 2; p++) {
+        si5351PLL_t pll = p ? SI5351_PLL_B : SI5351_PLL_A;
+        uint64_t M;
+        uint32_t c;
+
+        recordPLL(pll);
+        if (!getPLLRatio(pll, &M, &c) || (M < 15ULL * c) || (M > 90ULL * c)) {
+          *(p ? &m_si5351Config.pllb_configured
+              : &m_si5351Config.plla_configured) = false;
+          *(p ? &m_si5351Config.pllb_freq : &m_si5351Config.plla_freq) = 0;
+        }
+      }
+
+      m_si5351Config.initialised = true;
+      if (warm)
+        *warm = true;
+      return ERROR_NONE;
+    }
+  }
+
   /* Disable all outputs setting CLKx_DIS high */
   ASSERT_STATUS(write8(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 0xFF));
 
-  /* Power down all output drivers */
-  ASSERT_STATUS(write8(SI5351_REGISTER_16_CLK0_CONTROL, 0x80));
-  ASSERT_STATUS(write8(SI5351_REGISTER_17_CLK1_CONTROL, 0x80));
-  ASSERT_STATUS(write8(SI5351_REGISTER_18_CLK2_CONTROL, 0x80));
-  ASSERT_STATUS(write8(SI5351_REGISTER_19_CLK3_CONTROL, 0x80));
-  ASSERT_STATUS(write8(SI5351_REGISTER_20_CLK4_CONTROL, 0x80));
-  ASSERT_STATUS(write8(SI5351_REGISTER_21_CLK5_CONTROL, 0x80));
-  ASSERT_STATUS(write8(SI5351_REGISTER_22_CLK6_CONTROL, 0x80));
-  ASSERT_STATUS(write8(SI5351_REGISTER_23_CLK7_CONTROL, 0x80));
+  /* Power down all output drivers, in one burst. They are left at 8mA
+     from their own multisynth, which setupMultisynth() keeps */
+  uint8_t ctrl[8];
+  memset(ctrl, 0x8F, sizeof(ctrl));
+  ASSERT_STATUS(writeBurst(SI5351_REGISTER_16_CLK0_CONTROL, ctrl, 8));
 
   /* Set the load capacitance for the XTAL */
   ASSERT_STATUS(write8(SI5351_REGISTER_183_CRYSTAL_INTERNAL_LOAD_CAPACITANCE,
@@ -148,7 +312,7 @@ err_t Adafruit_SI5351::begin(TwoWire *theWire) {
 */
 /**************************************************************************/
 err_t Adafruit_SI5351::setClockBuilderData(void) {
-  uint16_t i = 0;
+  SI5351_STATS_SCOPE(SI5351_STATS_BEGIN);
 
   /* Make sure we've called init first */
   ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
@@ -158,10 +322,7 @@ err_t Adafruit_SI5351::setClockBuilderData(void) {
 
   /* Writes configuration data to device using the register map contents
          generated by ClockBuilder Desktop (registers 15-92 + 149-170) */
-  for (i = 0; i < sizeof(m_si5351_regs_15to92_149to170) / 2; i++) {
-    ASSERT_STATUS(write8(m_si5351_regs_15to92_149to170[i][0],
-                         m_si5351_regs_15to92_149to170[i][1]));
-  }
+  ASSERT_STATUS(loadRegisterMap(m_si5351_clockbuilder_map));
 
   /* Apply soft reset */
   ASSERT_STATUS(write8(SI5351_REGISTER_177_PLL_RESET, 0xAC));
@@ -172,6 +333,440 @@ err_t Adafruit_SI5351::setClockBuilderData(void) {
   return ERROR_NONE;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Writes a register map stored in flash (PROGMEM) to the device,
+            using one burst per run of consecutive registers
+
+    @param  map   The register map: any number of runs, each made of the
+                  start register, the run length and then the register
+                  values, terminated with SI5351_MAP_END
+
+    @code
+    static const uint8_t plan[] PROGMEM = {
+        16, 3, 0x4F, 0x4F, 0x6F, // CLK0..CLK2 control
+        SI5351_MAP_END};
+    clockgen.loadRegisterMap(plan);
+    @endcode
+
+    Maps can be built and checked at compile time with the
+    SI5351_MAP_PLL(), SI5351_MAP_MULTISYNTH() and related macros (see
+    Adafruit_SI5351.h). A PLL the map programs counts as set up
+    afterwards, for getPLLFrequency() and setFrequency(). Inside a
+    transaction the map is staged like any other write.
+
+    @note   This only writes registers. Disabling the outputs beforehand
+            and resetting the PLLs afterwards is up to the caller, or to
+            the map itself (SI5351_MAP_RESET).
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::loadRegisterMap(const uint8_t *map) {
+  SI5351_STATS_SCOPE(SI5351_STATS_BEGIN);
+
+  uint8_t plls = 0; /* Bit 0 PLL A, bit 1 PLL B */
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+
+  while (true) {
+    uint8_t reg = pgm_read_byte(map++);
+    uint8_t len = pgm_read_byte(map++);
+    if (len == 0)
+      break;
+    ASSERT(reg + len <= SI5351_REGISTER_CACHE_SIZE, ERROR_ADDRESSOUTOFRANGE);
+    if ((reg < 34) && (reg + len > 26))
+      plls |= 0x01;
+    if ((reg < 42) && (reg + len > 34))
+      plls |= 0x02;
+
+    if (m_inTransaction) {
+      /* Staging compares against the cache, so it must see the old value */
+      for (uint8_t i = 0; i < len; i++) {
+        uint8_t value = pgm_read_byte(map++);
+        ASSERT_STATUS(stageBurst(reg + i, &value, 1));
+      }
+      continue;
+    }
+
+    /* Stage the run in the shadow cache and burst it out from there, so
+       flash data never needs a RAM copy of its own */
+    for (uint8_t i = 0; i < len; i++)
+      m_regCache[reg + i] = pgm_read_byte(map++);
+    ASSERT_STATUS(writeBurst(reg, &m_regCache[reg], len));
+  }
+
+  if (plls & 0x01)
+    recordPLL(SI5351_PLL_A);
+  if (plls & 0x02)
+    recordPLL(SI5351_PLL_B);
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a ClockBuilder Pro register export read from a Stream
+            (SD card file, Serial, flash file system ...) to the device
+
+    @param  file  The stream to read the export from, until it ends or a
+                  read times out
+
+    The text is parsed as it arrives, one line per register: an address
+    and a value, separated by commas, spaces or braces. Both the CSV
+    export ("Address,Data" / "21,6Fh") and the C header export
+    ("{ 0x0015, 0x6F },") are accepted: numbers are decimal, 0x-prefixed
+    hex or h-suffixed hex. Lines that do not start with a number, such as
+    comments and headers, are skipped. Consecutive registers are grouped
+    into bursts of up to SI5351_IMPORT_BUFFER values, so the map never
+    needs to fit in RAM.
+
+    @code
+    File plan = SD.open("plan.txt");
+    clockgen.loadRegisterFile(&plan);
+    plan.close();
+    @endcode
+
+    @note   Like loadRegisterMap(), this only writes registers. Disabling
+            the outputs beforehand and resetting the PLLs afterwards is up
+            to the caller (unless the export itself does so). A malformed
+            line stops the import, possibly after some of the registers
+            before it were written.
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::loadRegisterFile(Stream *file) {
+  SI5351_STATS_SCOPE(SI5351_STATS_BEGIN);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(file, ERROR_INVALIDPARAMETER);
+
+  uint8_t run[SI5351_IMPORT_BUFFER]; /* Values of the burst being built */
+  uint8_t runStart = 0, runLen = 0;
+  char field[8]; /* Text of the number being read */
+  uint8_t fieldLen = 0;
+  uint8_t fieldCount = 0; /* Numbers read on this line so far */
+  bool skipLine = false;
+  uint16_t addr = 0;
+  bool end = false;
+
+  while (!end) {
+    char c;
+    if (file->readBytes(&c, 1) == 0) {
+      /* End of the stream finishes the current line */
+      end = true;
+      c = '\n';
+    }
+    bool eol = (c == '\n') || (c == '\r');
+
+    if (skipLine) {
+      /* Comment, header or surplus column: wait for the next line */
+    } else if (eol || (c == ',') || (c == ' ') || (c == '\t') ||
+               (c == '{') || (c == '}')) {
+      if (fieldLen) {
+        uint16_t number;
+        field[fieldLen] = 0;
+        fieldLen = 0;
+        ASSERT(parseRegisterField(field, &number), ERROR_UNEXPECTEDVALUE);
+        if (fieldCount == 0) {
+          ASSERT(number < SI5351_REGISTER_CACHE_SIZE, ERROR_ADDRESSOUTOFRANGE);
+          addr = number;
+        } else {
+          ASSERT(number <= 0xFF, ERROR_UNEXPECTEDVALUE);
+          /* Send the run so far if this register does not extend it */
+          if (runLen && ((addr != runStart + runLen) ||
+                         (runLen == SI5351_IMPORT_BUFFER))) {
+            ASSERT_STATUS(writeBurst(runStart, run, runLen));
+            runLen = 0;
+          }
+          if (runLen == 0)
+            runStart = addr;
+          run[runLen++] = number;
+          /* Anything after the value is ignored */
+          skipLine = true;
+        }
+        fieldCount++;
+      }
+    } else if ((fieldCount == 0) && (fieldLen == 0) &&
+               ((c < '0') || (c > '9'))) {
+      skipLine = true;
+    } else {
+      ASSERT(fieldLen < sizeof(field) - 1, ERROR_UNEXPECTEDVALUE);
+      field[fieldLen++] = c;
+    }
+
+    if (eol) {
+      /* An address needs its value on the same line */
+      ASSERT(fieldCount != 1, ERROR_UNEXPECTEDVALUE);
+      fieldCount = 0;
+      skipLine = false;
+    }
+  }
+
+  if (runLen)
+    ASSERT_STATUS(writeBurst(runStart, run, runLen));
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Saves the current configuration as a compact blob, to keep in
+            EEPROM, flash or any buffer and replay with restorePlan()
+
+    @param  blob  Receives the plan
+    @param  size  Size of blob; SI5351_PLAN_MAX_SIZE is always enough
+    @param  len   Receives the number of bytes used
+
+    The blob holds the crystal, calibration and PLL state (m_si5351Config)
+    and every register the shadow cache knows in 2..3, 9, 15..92,
+    149..170, 183 and 187, as runs of consecutive registers. It starts
+    with a versioned header and ends with a CRC-16, so a stale or
+    corrupted copy is refused. A device configured by other means
+    (ClockBuilder, another master) can be captured by calling
+    syncFromDevice() first.
+
+    @code
+    uint8_t blob[SI5351_PLAN_MAX_SIZE];
+    uint16_t len;
+    clockgen.savePlan(blob, sizeof(blob), &len);
+    for (uint16_t i = 0; i < len; i++)
+      EEPROM.update(i, blob[i]);
+    @endcode
+
+    @return ERROR_NONE, or ERROR_BUFFEROVERFLOW if blob is too small
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::savePlan(uint8_t *blob, uint16_t size, uint16_t *len) {
+  uint32_t words[5] = {(uint32_t)m_si5351Config.crystalFreq,
+                       m_si5351Config.crystalPPM, m_si5351Config.plla_freq,
+                       m_si5351Config.pllb_freq,
+                       (uint32_t)m_si5351Config.crystalPPB};
+  uint16_t pos = 0;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(!m_inTransaction, ERROR_UNEXPECTEDVALUE);
+  ASSERT(blob && len, ERROR_INVALIDPARAMETER);
+  ASSERT(size >= SI5351_PLAN_HEADER + 4, ERROR_BUFFEROVERFLOW);
+
+  blob[pos++] = SI5351_PLAN_MAGIC_0;
+  blob[pos++] = SI5351_PLAN_MAGIC_1;
+  blob[pos++] = SI5351_PLAN_VERSION;
+  pos += 2; /* Length, filled in at the end */
+  for (uint8_t w = 0; w < 5; w++) {
+    for (uint8_t i = 0; i < 4; i++)
+      blob[pos++] = words[w] >> (8 * i);
+  }
+  blob[pos++] = m_si5351Config.crystalLoad;
+  blob[pos++] = (m_si5351Config.plla_configured ? 0x01 : 0) |
+                (m_si5351Config.pllb_configured ? 0x02 : 0);
+
+  /* One record per run of registers the cache holds */
+  for (uint8_t r = 0; r < sizeof(m_si5351_plan_ranges) / 2; r++) {
+    uint8_t reg = m_si5351_plan_ranges[r][0];
+    uint8_t end = reg + m_si5351_plan_ranges[r][1];
+    while (reg < end) {
+      if (!isCached(reg)) {
+        reg++;
+        continue;
+      }
+      uint8_t runLen = 0;
+      while ((reg + runLen < end) && isCached(reg + runLen))
+        runLen++;
+      ASSERT(pos + 2 + runLen + 4 <= size, ERROR_BUFFEROVERFLOW);
+      blob[pos++] = reg;
+      blob[pos++] = runLen;
+      memcpy(&blob[pos], &m_regCache[reg], runLen);
+      pos += runLen;
+      reg += runLen;
+    }
+  }
+  blob[pos++] = 0;
+  blob[pos++] = 0;
+
+  blob[3] = (pos + 2) & 0xFF;
+  blob[4] = (pos + 2) >> 8;
+  uint16_t crc = crc16(blob, pos);
+  blob[pos++] = crc & 0xFF;
+  blob[pos++] = crc >> 8;
+
+  *len = pos;
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Replays a plan saved by savePlan()
+
+    @param  blob  The saved plan (read back into RAM)
+    @param  len   Number of bytes available in blob, at least the saved
+                  length
+
+    The blob is checked in full before anything is written. The registers
+    then go out as one transaction (see beginTransaction()): outputs are
+    disabled, the runs are sent as bursts, the PLLs are reset if their
+    parameters changed and the saved output enables are written last.
+    Registers that already hold the saved values are skipped. This should
+    follow begin(), with the same crystal as when the plan was saved.
+
+    @return ERROR_NONE, or ERROR_UNEXPECTEDVALUE if the blob is not a
+            plan of this version or fails its CRC
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::restorePlan(const uint8_t *blob, uint16_t len) {
+  SI5351_STATS_SCOPE(SI5351_STATS_BEGIN);
+
+  uint32_t words[5] = {0, 0, 0, 0, 0};
+  uint16_t pos = 5;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(blob, ERROR_INVALIDPARAMETER);
+
+  /* Header and CRC */
+  ASSERT(len >= SI5351_PLAN_HEADER + 4, ERROR_UNEXPECTEDVALUE);
+  ASSERT((blob[0] == SI5351_PLAN_MAGIC_0) && (blob[1] == SI5351_PLAN_MAGIC_1),
+         ERROR_UNEXPECTEDVALUE);
+  ASSERT(blob[2] == SI5351_PLAN_VERSION, ERROR_UNEXPECTEDVALUE);
+  uint16_t size = blob[3] | ((uint16_t)blob[4] << 8);
+  ASSERT((size >= SI5351_PLAN_HEADER + 4) && (size <= len),
+         ERROR_UNEXPECTEDVALUE);
+  ASSERT(crc16(blob, size - 2) ==
+             (blob[size - 2] | ((uint16_t)blob[size - 1] << 8)),
+         ERROR_UNEXPECTEDVALUE);
+
+  for (uint8_t w = 0; w < 5; w++) {
+    for (uint8_t i = 0; i < 4; i++)
+      words[w] |= (uint32_t)blob[pos++] << (8 * i);
+  }
+  uint8_t load = blob[pos++];
+  uint8_t pllFlags = blob[pos++];
+
+  /* Every record must lie within the blob and the register map */
+  uint16_t records = pos;
+  while (true) {
+    ASSERT(pos + 2 <= size - 2, ERROR_UNEXPECTEDVALUE);
+    uint8_t reg = blob[pos];
+    uint8_t runLen = blob[pos + 1];
+    pos += 2;
+    if (runLen == 0)
+      break;
+    ASSERT((reg + runLen <= SI5351_REGISTER_CACHE_SIZE) &&
+               (pos + runLen <= size - 2),
+           ERROR_UNEXPECTEDVALUE);
+    pos += runLen;
+  }
+
+  ASSERT_STATUS(beginTransaction(true));
+  for (pos = records; blob[pos + 1] != 0; pos += 2 + blob[pos + 1])
+    ASSERT_STATUS(writeBurst(blob[pos], &blob[pos + 2], blob[pos + 1]));
+
+  /* New feedback dividers only take effect cleanly after a PLL reset */
+  uint8_t rst = 0;
+  for (uint8_t reg = 26; reg < 42; reg++) {
+    /* PLLA_RST is bit 5, PLLB_RST is bit 7 */
+    if (isDirty(reg))
+      rst |= (reg < 34) ? (1 << 5) : (1 << 7);
+  }
+  if (rst)
+    ASSERT_STATUS(writeBurst(SI5351_REGISTER_177_PLL_RESET, &rst, 1));
+  ASSERT_STATUS(commit());
+
+  m_si5351Config.crystalFreq = (si5351CrystalFreq_t)words[0];
+  m_si5351Config.crystalPPM = words[1];
+  m_si5351Config.plla_freq = words[2];
+  m_si5351Config.pllb_freq = words[3];
+  m_si5351Config.crystalPPB = (int32_t)words[4];
+  m_si5351Config.crystalLoad = (si5351CrystalLoad_t)load;
+  m_si5351Config.plla_configured = pllFlags & 0x01;
+  m_si5351Config.pllb_configured = pllFlags & 0x02;
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+*/
+/**************************************************************************/
+uint16_t Adafruit_SI5351::crc16(const uint8_t *data, uint16_t len) {
+  uint16_t crc = 0xFFFF;
+
+  while (len--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+  }
+
+  return crc;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks a register map (see loadRegisterMap()) against the
+            shadow cache
+
+    @return False if any cached register the map sets differs from it;
+            registers the cache does not hold are not compared
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::planMatches(const uint8_t *map) {
+  while (true) {
+    uint8_t reg = pgm_read_byte(map++);
+    uint8_t len = pgm_read_byte(map++);
+    if (len == 0)
+      break;
+    for (uint8_t i = 0; i < len; i++) {
+      uint8_t value = pgm_read_byte(map++);
+      if (isCached(reg + i) && (m_regCache[reg + i] != value))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Parses one number of a register export: decimal, 0x-prefixed
+            hex or h-suffixed hex
+
+    @return False if the text is not a number or does not fit 16 bits
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::parseRegisterField(const char *text, uint16_t *number) {
+  uint8_t base = 10;
+  uint32_t value = 0;
+  uint8_t len = strlen(text);
+
+  if ((len > 2) && (text[0] == '0') && ((text[1] == 'x') || (text[1] == 'X'))) {
+    base = 16;
+    text += 2;
+    len -= 2;
+  } else if ((len > 1) &&
+             ((text[len - 1] == 'h') || (text[len - 1] == 'H'))) {
+    base = 16;
+    len--;
+  }
+
+  for (uint8_t i = 0; i < len; i++) {
+    char c = text[i];
+    uint8_t digit;
+    if ((c >= '0') && (c <= '9'))
+      digit = c - '0';
+    else if ((c >= 'a') && (c <= 'f'))
+      digit = c - 'a' + 10;
+    else if ((c >= 'A') && (c <= 'F'))
+      digit = c - 'A' + 10;
+    else
+      return false;
+    if (digit >= base)
+      return false;
+    value = value * base + digit;
+    if (value > 0xFFFF)
+      return false;
+  }
+
+  *number = value;
+  return true;
+}
+
 /**************************************************************************/
 /*!
   @brief  Sets the multiplier for the specified PLL using integer values
@@ -213,14 +808,16 @@ err_t Adafruit_SI5351::setupPLLInt(si5351PLL_t pll, uint8_t mult) {
     NOTE: Try to use integers whenever possible to avoid clock jitter
     (only use the a part, setting b to '0' and c to '1').
 
+    The PLL is reset after the update, unless fast retune mode is on and
+    the integer part of the multiplier did not change (see
+    enableFastRetune()).
+
     See: http://www.silabs.com/Support%20Documents/TechnicalDocs/AN619.pdf
 */
 /**************************************************************************/
 err_t Adafruit_SI5351::setupPLL(si5351PLL_t pll, uint8_t mult, uint32_t num,
                                 uint32_t denom) {
-  uint32_t P1; /* PLL config register P1 */
-  uint32_t P2; /* PLL config register P2 */
-  uint32_t P3; /* PLL config register P3 */
+  SI5351_STATS_SCOPE(SI5351_STATS_PLL);
 
   /* Basic validation */
   ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
@@ -245,339 +842,3502 @@ err_t Adafruit_SI5351::setupPLL(si5351PLL_t pll, uint8_t mult, uint32_t num,
    * P3 register is a 20-bit value using the following formula:
    *
    * 	P3[19:0] = denom
+   *
+   * See encodeDivider() for the register layout.
    */
 
-  /* Set the main PLL config registers */
-  if (num == 0) {
-    /* Integer mode */
-    P1 = 128 * mult - 512;
-    P2 = num;
-    P3 = denom;
-  } else {
-    /* Fractional mode */
-    P1 =
-        (uint32_t)(128 * mult + floor(128 * ((float)num / (float)denom)) - 512);
-    P2 = (uint32_t)(128 * num -
-                    denom * floor(128 * ((float)num / (float)denom)));
-    P3 = denom;
-  }
-
   /* Get the appropriate starting point for the PLL registers */
   uint8_t baseaddr = (pll == SI5351_PLL_A ? 26 : 34);
 
-  /* The datasheet is a nightmare of typos and inconsistencies here! */
-  ASSERT_STATUS(write8(baseaddr, (P3 & 0x0000FF00) >> 8));
-  ASSERT_STATUS(write8(baseaddr + 1, (P3 & 0x000000FF)));
-  ASSERT_STATUS(write8(baseaddr + 2, (P1 & 0x00030000) >> 16));
-  ASSERT_STATUS(write8(baseaddr + 3, (P1 & 0x0000FF00) >> 8));
-  ASSERT_STATUS(write8(baseaddr + 4, (P1 & 0x000000FF)));
-  ASSERT_STATUS(write8(baseaddr + 5,
-                       ((P3 & 0x000F0000) >> 12) | ((P2 & 0x000F0000) >> 16)));
-  ASSERT_STATUS(write8(baseaddr + 6, (P2 & 0x0000FF00) >> 8));
-  ASSERT_STATUS(write8(baseaddr + 7, (P2 & 0x000000FF)));
-
-  /* Reset both PLLs */
-  ASSERT_STATUS(write8(SI5351_REGISTER_177_PLL_RESET, (1 << 7) | (1 << 5)));
+  uint8_t regs[8];
+  encodeDivider(mult, num, denom, regs);
 
-  /* Store the frequency settings for use with the Multisynth helper */
-  if (pll == SI5351_PLL_A) {
-    float fvco =
-        m_si5351Config.crystalFreq * (mult + ((float)num / (float)denom));
-    m_si5351Config.plla_configured = true;
-    m_si5351Config.plla_freq = (uint32_t)floor(fvco);
+  /* In fast retune mode a change that keeps the integer part of the
+     multiplier is written as is: the PLL tracks it without losing lock */
+  uint64_t oldM;
+  uint32_t oldC;
+  if (m_fastRetune && getPLLRatio(pll, &oldM, &oldC) &&
+      (oldM / oldC == mult + num / denom)) {
+    /* Only the bytes that changed, usually just the low P2 bytes */
+    ASSERT_STATUS(writeBurstDelta(baseaddr, regs, 8));
   } else {
-    float fvco =
-        m_si5351Config.crystalFreq * (mult + ((float)num / (float)denom));
-    m_si5351Config.pllb_configured = true;
-    m_si5351Config.pllb_freq = (uint32_t)floor(fvco);
+    /* Burst mode: register address auto-increases */
+    ASSERT_STATUS(writeBurst(baseaddr, regs, 8));
+
+    /* Reset the PLL we just changed, leaving the other one running */
+    ASSERT_STATUS(resetPLL(pll));
   }
 
+  /* Store the frequency settings for use with the Multisynth helper */
+  recordPLL(pll);
+
   return ERROR_NONE;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Configures the Multisynth divider using integer output.
-
-    @param  output    The output channel to use (0..2)
-    @param  pllSource	The PLL input source to use, which must be one of:
-                      - SI5351_PLL_A
-                      - SI5351_PLL_B
-    @param  div       The integer divider for the Multisynth output,
-                      which must be one of the following values:
-                      - SI5351_MULTISYNTH_DIV_4
-                      - SI5351_MULTISYNTH_DIV_6
-                      - SI5351_MULTISYNTH_DIV_8
+    @brief  Issues a soft reset of a single PLL, leaving the other untouched
+    @param  pll   The PLL to reset, which must be one of the following:
+                  - SI5351_PLL_A
+                  - SI5351_PLL_B
+    @return ERROR_NONE
 */
 /**************************************************************************/
-err_t Adafruit_SI5351::setupMultisynthInt(uint8_t output, si5351PLL_t pllSource,
-                                          si5351MultisynthDiv_t div) {
-  return setupMultisynth(output, pllSource, div, 0, 1);
+err_t Adafruit_SI5351::resetPLL(si5351PLL_t pll) {
+  SI5351_STATS_SCOPE(SI5351_STATS_PLL);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+
+  /* PLLA_RST is bit 5, PLLB_RST is bit 7 */
+  return write8(SI5351_REGISTER_177_PLL_RESET,
+                pll == SI5351_PLL_A ? (1 << 5) : (1 << 7));
 }
 
-err_t Adafruit_SI5351::setupRdiv(uint8_t output, si5351RDiv_t div) {
-  ASSERT(output < 3, ERROR_INVALIDPARAMETER); /* Channel range */
+/**************************************************************************/
+/*!
+    @brief  Reads the device status register (register 0)
 
-  uint8_t Rreg, regval;
+    @param  status  Receives the SI5351_STATUS_* bits that are set; a PLL
+                    is locked while its SI5351_STATUS_LOL_x bit is clear
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::getDeviceStatus(uint8_t *status) {
+  SI5351_STATS_SCOPE(SI5351_STATS_LOCK);
 
-  if (output == 0)
-    Rreg = SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3;
-  if (output == 1)
-    Rreg = SI5351_REGISTER_52_MULTISYNTH1_PARAMETERS_3;
-  if (output == 2)
-    Rreg = SI5351_REGISTER_60_MULTISYNTH2_PARAMETERS_3;
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
 
-  read8(Rreg, &regval);
+  uint8_t regval;
+  ASSERT_STATUS(read8(SI5351_REGISTER_0_DEVICE_STATUS, &regval));
+#ifdef SI5351_ENABLE_STATS
+  noteLockStatus(regval);
+#endif
+  *status = regval;
 
-  regval &= 0x0F;
-  uint8_t divider = div;
-  divider &= 0x07;
-  divider <<= 4;
-  regval |= divider;
-  lastRdivValue[output] = divider;
-  return write8(Rreg, regval);
+  return ERROR_NONE;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Configures the Multisynth divider, which determines the
-            output clock frequency based on the specified PLL input.
-
-    @param  output    The output channel to use (0..2)
-    @param  pllSource	The PLL input source to use, which must be one of:
-                      - SI5351_PLL_A
-                      - SI5351_PLL_B
-    @param  div       The integer divider for the Multisynth output.
-                      If pure integer values are used, this value must
-                      be one of:
-                      - SI5351_MULTISYNTH_DIV_4
-                      - SI5351_MULTISYNTH_DIV_6
-                      - SI5351_MULTISYNTH_DIV_8
-                      If fractional output is used, this value must be
-                      between 8 and 900.
-    @param  num       The 20-bit numerator for fractional output
-                      (0..1,048,575). Set this to '0' for integer output.
-    @param  denom     The 20-bit denominator for fractional output
-                      (1..1,048,575). Set this to '1' or higher to
-                      avoid divide by zero errors.
+    @brief  Polls the device status until a PLL is locked, e.g. after
+            setupPLL() or resetPLL(), instead of a fixed delay()
 
-    @section Output Clock Configuration
+    @param  pll         The PLL to wait for, which must be one of the
+                        following:
+                        - SI5351_PLL_A
+                        - SI5351_PLL_B
+    @param  timeout_ms  How long to wait for the lock
 
-    The multisynth dividers are applied to the specified PLL output,
-    and are used to reduce the PLL output to a valid range (500kHz
-    to 160MHz). The relationship can be seen in this formula, where
-    fVCO is the PLL output frequency and MSx is the multisynth
-    divider:
+    Queued asynchronous writes are sent first, so their PLL reset is
+    waited for too. With SI5351_ENABLE_STATS defined, the time from the
+    last reset to the lock is counted in the stats (lock).
 
-        fOUT = fVCO / MSx
+    @return ERROR_NONE once LOL_A/LOL_B and SYS_INIT are clear, or
+            ERROR_OPERATIONTIMEDOUT if they are still set after timeout_ms
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::waitForLock(si5351PLL_t pll, uint32_t timeout_ms) {
+  SI5351_STATS_SCOPE(SI5351_STATS_LOCK);
 
-    Valid multisynth dividers are 4, 6, or 8 when using integers,
-    or any fractional values between 8 + 1/1,048,575 and 900 + 0/1
+  uint8_t busy = SI5351_STATUS_SYS_INIT |
+                 (pll == SI5351_PLL_A ? SI5351_STATUS_LOL_A
+                                      : SI5351_STATUS_LOL_B);
+  uint32_t start = millis();
+  uint8_t regval;
 
-    The following formula is used for the fractional mode divider:
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(!m_inTransaction, ERROR_UNEXPECTEDVALUE);
+  ASSERT_STATUS(flush());
 
-        a + b / c
+  while (true) {
+    ASSERT_STATUS(getDeviceStatus(&regval));
+    if (!(regval & busy))
+      return ERROR_NONE;
+    if ((uint32_t)(millis() - start) >= timeout_ms)
+      return ERROR_OPERATIONTIMEDOUT;
+    yield(); /* Keeps the ESP8266/ESP32 watchdog fed */
+  }
+}
 
-    a = The integer value, which must be 4, 6 or 8 in integer mode (MSx_INT=1)
-        or 8..900 in fractional mode (MSx_INT=0).
-    b = The fractional numerator (0..1,048,575)
-    c = The fractional denominator (1..1,048,575)
+/**************************************************************************/
+/*!
+    @brief  Lets the INTR pin (Si5351B/C) report PLL lock changes, so no
+            status polling is needed
 
-    @note   Try to use integers whenever possible to avoid clock jitter
+    @param  pin       The MCU pin wired to INTR, or -1 to stop
+    @param  callback  Called by poll() with register 0 each time the pin
+                      fires, or NULL
 
-    @note   For output frequencies > 150MHz, you must set the divider
-            to 4 and adjust to PLL to generate the frequency (for example
-            a PLL of 640 to generate a 160MHz output clock). This is not
-            yet supported in the driver, which limits frequencies to
-            500kHz .. 150MHz.
+    Only LOL_A and LOL_B are unmasked in register 2. The interrupt itself
+    only sets a flag: poll() then reads and clears the sticky register 1,
+    reads register 0 and calls the callback, so no I2C traffic happens in
+    interrupt context. Only one device can use this at a time.
 
-    @note   For frequencies below 500kHz (down to 8kHz) Rx_DIV must be
-            used, but this isn't currently implemented in the driver.
+    @return ERROR_NONE
 */
 /**************************************************************************/
-err_t Adafruit_SI5351::setupMultisynth(uint8_t output, si5351PLL_t pllSource,
-                                       uint32_t div, uint32_t num,
-                                       uint32_t denom) {
-  uint32_t P1; /* Multisynth config register P1 */
-  uint32_t P2; /* Multisynth config register P2 */
-  uint32_t P3; /* Multisynth config register P3 */
+err_t Adafruit_SI5351::enableLockInterrupt(int8_t pin,
+                                           si5351StatusCallback_t callback) {
+  SI5351_STATS_SCOPE(SI5351_STATS_LOCK);
+
+  uint8_t mask;
 
-  /* Basic validation */
   ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
-  ASSERT(output < 3, ERROR_INVALIDPARAMETER);       /* Channel range */
-  ASSERT(div > 3, ERROR_INVALIDPARAMETER);          /* Divider integer value */
-  ASSERT(div < 2049, ERROR_INVALIDPARAMETER);       /* Divider integer value */
-  ASSERT(denom > 0, ERROR_INVALIDPARAMETER);        /* Avoid divide by zero */
-  ASSERT(num <= 0xFFFFF, ERROR_INVALIDPARAMETER);   /* 20-bit limit */
-  ASSERT(denom <= 0xFFFFF, ERROR_INVALIDPARAMETER); /* 20-bit limit */
 
-  /* Make sure the requested PLL has been initialised */
-  if (pllSource == SI5351_PLL_A) {
-    ASSERT(m_si5351Config.plla_configured, ERROR_INVALIDPARAMETER);
-  } else {
-    ASSERT(m_si5351Config.pllb_configured, ERROR_INVALIDPARAMETER);
+  if (m_intPin >= 0)
+    detachInterrupt(digitalPinToInterrupt(m_intPin));
+  m_intPin = -1;
+  m_statusCallback = callback;
+
+  ASSERT_STATUS(readCached(SI5351_REGISTER_2_INTERRUPT_STATUS_MASK, &mask));
+  if (pin < 0) {
+    mask |= SI5351_STATUS_LOL_A | SI5351_STATUS_LOL_B;
+    return write8(SI5351_REGISTER_2_INTERRUPT_STATUS_MASK, mask);
   }
 
-  /* Output Multisynth Divider Equations
-   *
-   * where: a = div, b = num and c = denom
-   *
-   * P1 register is an 18-bit value using following formula:
-   *
-   * 	P1[17:0] = 128 * a + floor(128*(b/c)) - 512
-   *
-   * P2 register is a 20-bit value using the following formula:
-   *
-   * 	P2[19:0] = 128 * b - c * floor(128*(b/c))
-   *
-   * P3 register is a 20-bit value using the following formula:
-   *
-   * 	P3[19:0] = c
-   */
+  /* Start from a clear sticky register, so INTR is released */
+  mask |= SI5351_STATUS_SYS_INIT | SI5351_STATUS_LOS_CLKIN |
+          SI5351_STATUS_LOS_XTAL;
+  mask &= ~(SI5351_STATUS_LOL_A | SI5351_STATUS_LOL_B);
+  ASSERT_STATUS(write8(SI5351_REGISTER_2_INTERRUPT_STATUS_MASK, mask));
+  ASSERT_STATUS(write8(SI5351_REGISTER_1_INTERRUPT_STATUS_STICKY, 0x00));
 
-  /* Set the main PLL config registers */
-  if (num == 0) {
-    /* Integer mode */
-    P1 = 128 * div - 512;
-    P2 = 0;
-    P3 = denom;
-  } else if (denom == 1) {
-    /* Fractional mode, simplified calculations */
-    P1 = 128 * div + 128 * num - 512;
-    P2 = 128 * num - 128;
-    P3 = 1;
-  } else {
-    /* Fractional mode */
-    P1 = (uint32_t)(128 * div + floor(128 * ((float)num / (float)denom)) - 512);
-    P2 = (uint32_t)(128 * num -
-                    denom * floor(128 * ((float)num / (float)denom)));
-    P3 = denom;
-  }
+  m_si5351Interrupt = false;
+  m_intPin = pin;
+  attachInterrupt(digitalPinToInterrupt(pin), si5351InterruptHandler,
+                  FALLING);
 
-  /* Get the appropriate starting point for the PLL registers */
-  uint8_t baseaddr = 0;
-  switch (output) {
-  case 0:
-    baseaddr = SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1;
-    break;
-  case 1:
-    baseaddr = SI5351_REGISTER_50_MULTISYNTH1_PARAMETERS_1;
-    break;
-  case 2:
-    baseaddr = SI5351_REGISTER_58_MULTISYNTH2_PARAMETERS_1;
-    break;
-  }
-
-  /* Set the MSx config registers */
-  /* Burst mode: register address auto-increases */
-  uint8_t sendBuffer[9];
-  sendBuffer[0] = baseaddr;
-  sendBuffer[1] = (P3 & 0xFF00) >> 8;
-  sendBuffer[2] = P3 & 0xFF;
-  sendBuffer[3] = ((P1 & 0x30000) >> 16) | lastRdivValue[output];
-  sendBuffer[4] = (P1 & 0xFF00) >> 8;
-  sendBuffer[5] = P1 & 0xFF;
-  sendBuffer[6] = ((P3 & 0xF0000) >> 12) | ((P2 & 0xF0000) >> 16);
-  sendBuffer[7] = (P2 & 0xFF00) >> 8;
-  sendBuffer[8] = P2 & 0xFF;
-  ASSERT_STATUS(writeN(sendBuffer, 9));
-
-  /* Configure the clk control and enable the output */
-  /* TODO: Check if the clk control byte needs to be updated. */
-  uint8_t clkControlReg = 0x0F; /* 8mA drive strength, MS0 as CLK0 source, Clock
-                                   not inverted, powered up */
-  if (pllSource == SI5351_PLL_B)
-    clkControlReg |= (1 << 5); /* Uses PLLB */
-  if (num == 0)
-    clkControlReg |= (1 << 6); /* Integer mode */
-  switch (output) {
-  case 0:
-    ASSERT_STATUS(write8(SI5351_REGISTER_16_CLK0_CONTROL, clkControlReg));
-    break;
-  case 1:
-    ASSERT_STATUS(write8(SI5351_REGISTER_17_CLK1_CONTROL, clkControlReg));
-    break;
-  case 2:
-    ASSERT_STATUS(write8(SI5351_REGISTER_18_CLK2_CONTROL, clkControlReg));
-    break;
-  }
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Handles an INTR pin event for poll(): clears the sticky bits,
+            which releases the pin, and reports register 0
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::serviceInterrupt(void) {
+  SI5351_STATS_SCOPE(SI5351_STATS_LOCK);
+
+  uint8_t regval;
+
+  m_si5351Interrupt = false;
+  ASSERT_STATUS(write8(SI5351_REGISTER_1_INTERRUPT_STATUS_STICKY, 0x00));
+  ASSERT_STATUS(getDeviceStatus(&regval));
+  if (m_statusCallback)
+    m_statusCallback(regval);
 
   return ERROR_NONE;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Enables or disables all clock outputs
-    @param  enabled Whether output is enabled
-    @return ERROR_NONE
+    @brief  Enables or disables fast retune mode for setupPLL()
+
+    @param  enabled Whether fast retune mode is enabled
+
+    @section Fast Retune
+
+    With fast retune enabled, a setupPLL() call that keeps the integer
+    part of the multiplier only rewrites the parameter bytes that
+    changed (often just the P2 low bytes), and does not reset the PLL.
+    The PLL follows small fractional steps without dropping lock, so the
+    outputs stay phase continuous, which suits FSK/WSPR keying and fine
+    tuning. Changing the integer multiplier still resets the affected
+    PLL, and only that PLL.
 */
 /**************************************************************************/
-err_t Adafruit_SI5351::enableOutputs(bool enabled) {
-  /* Make sure we've called init first */
+void Adafruit_SI5351::enableFastRetune(bool enabled) {
+  m_fastRetune = enabled;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Pulls a PLL by a signed amount, e.g. to discipline the outputs
+            against a GPS 1PPS, without a reset or any solver work
+
+    @param  pll   The PLL to tune, which must be one of the following:
+                  - SI5351_PLL_A
+                  - SI5351_PLL_B
+    @param  ppb   The correction in parts per billion, relative to the
+                  PLL as last set up (not to the previous correction)
+
+    The feedback divider is held as X / P3 with P3 = 1,048,575, which
+    gives steps of about 0.2ppb, and the correction is applied to X with
+    integer math. Only the bytes that change are written, normally just
+    P2 (registers 31..33 or 39..41, often only the last two). The first
+    correction after setupPLL() may also rewrite P3 and P1. The PLL is
+    not reset: it tracks the change without losing lock. Every output on
+    the PLL moves by the same ppb.
+
+    @return ERROR_NONE, or ERROR_INVALIDPARAMETER if the PLL is not set
+            up or the result leaves the 15..90 multiplier range
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::fineTunePLL(si5351PLL_t pll, int32_t ppb) {
+  SI5351_STATS_SCOPE(SI5351_STATS_PLL);
+
+  const uint32_t P3 = SI5351_FRAC_MAX;
+  uint8_t p = (pll == SI5351_PLL_A) ? 0 : 1;
+  uint8_t base = p ? 34 : 26;
+  uint64_t M;
+  uint32_t c, P1, P2, oldP3;
+
   ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(getPLLRatio(pll, &M, &c), ERROR_INVALIDPARAMETER);
 
-  /* Enabled desired outputs (see Register 3) */
-  ASSERT_STATUS(
-      write8(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, enabled ? 0x00 : 0xFF));
+  /* Anything we did not write ourselves is the new nominal setting */
+  decodeDivider(&m_regCache[base], &P1, &P2, &oldP3);
+  uint64_t X = (uint64_t)(P1 + 512) * oldP3 + P2;
+  if ((oldP3 != P3) || (X != m_fineX[p]))
+    m_fineBaseX[p] = mulDiv(X, P3, oldP3);
+
+  uint64_t delta =
+      mulDiv(m_fineBaseX[p], (ppb < 0) ? -(uint32_t)ppb : ppb, 1000000000UL);
+  X = (ppb < 0) ? m_fineBaseX[p] - delta : m_fineBaseX[p] + delta;
+  ASSERT((X >= 15ULL * 128 * P3) && (X <= 90ULL * 128 * P3),
+         ERROR_INVALIDPARAMETER);
+
+  /* FBA_INT/FBB_INT (CLK6/CLK7 control bit 6) would ignore P2 */
+  uint8_t ctrl;
+  uint8_t ctrlreg = SI5351_REGISTER_22_CLK6_CONTROL + p;
+  ASSERT_STATUS(readCached(ctrlreg, &ctrl));
+  if (ctrl & (1 << 6))
+    ASSERT_STATUS(write8(ctrlreg, ctrl & ~(1 << 6)));
+
+  uint8_t regs[8];
+  packDivider(X / P3 - 512, X % P3, P3, regs);
+  ASSERT_STATUS(writeBurstDelta(base, regs, 8));
+  m_fineX[p] = X;
+  recordPLL(pll);
 
   return ERROR_NONE;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Enables or disables spread spectrum
-    @param  enabled Whether spread spectrum output is enabled
-    @return ERROR_NONE
+    @brief  Sets the measured crystal error, which setFrequency() and the
+            other frequency solvers then correct for
+
+    @param  ppb   How far the crystal is above (positive) or below
+                  (negative) its nominal frequency, in parts per billion
+
+    This only affects frequencies solved from now on; use fineTunePLL()
+    to pull a running PLL.
 */
 /**************************************************************************/
-err_t Adafruit_SI5351::enableSpreadSpectrum(bool enabled) {
-  uint8_t regval;
-  ASSERT_STATUS(read8(SI5351_REGISTER_149_SPREAD_SPECTRUM_PARAMETERS, &regval));
-  if (enabled) {
-    regval |= 0x80;
+void Adafruit_SI5351::setCrystalCalibration(int32_t ppb) {
+  m_si5351Config.crystalPPB = ppb;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Configures the Multisynth divider using integer output.
+
+    @param  output    The output channel to use (0..7)
+    @param  pllSource	The PLL input source to use, which must be one of:
+                      - SI5351_PLL_A
+                      - SI5351_PLL_B
+    @param  div       The integer divider for the Multisynth output,
+                      which must be one of the following values:
+                      - SI5351_MULTISYNTH_DIV_4
+                      - SI5351_MULTISYNTH_DIV_6
+                      - SI5351_MULTISYNTH_DIV_8
+                      (outputs 6 and 7 can't divide by 4)
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setupMultisynthInt(uint8_t output, si5351PLL_t pllSource,
+                                          si5351MultisynthDiv_t div) {
+  return setupMultisynth(output, pllSource, div, 0, 1);
+}
+
+err_t Adafruit_SI5351::setupRdiv(uint8_t output, si5351RDiv_t div) {
+  SI5351_STATS_SCOPE(SI5351_STATS_MULTISYNTH);
+
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER); /* Channel range */
+
+  uint8_t Rreg, regval, shift;
+
+  Rreg = rdivRegister(output, &shift);
+
+  ASSERT_STATUS(readCached(Rreg, &regval));
+
+  regval &= ~(0x07 << shift);
+  uint8_t divider = div;
+  divider &= 0x07;
+  divider <<= shift;
+  regval |= divider;
+  return write8(Rreg, regval);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Configures the Multisynth divider, which determines the
+            output clock frequency based on the specified PLL input.
+
+    @param  output    The output channel to use (0..7)
+    @param  pllSource	The PLL input source to use, which must be one of:
+                      - SI5351_PLL_A
+                      - SI5351_PLL_B
+    @param  div       The integer divider for the Multisynth output.
+                      If pure integer values are used, this value must
+                      be one of:
+                      - SI5351_MULTISYNTH_DIV_4
+                      - SI5351_MULTISYNTH_DIV_6
+                      - SI5351_MULTISYNTH_DIV_8
+                      If fractional output is used, this value must be
+                      between 8 and 2048.
+    @param  num       The 20-bit numerator for fractional output
+                      (0..1,048,575). Set this to '0' for integer output.
+    @param  denom     The 20-bit denominator for fractional output
+                      (1..1,048,575). Set this to '1' or higher to
+                      avoid divide by zero errors.
+
+    @section Output Clock Configuration
+
+    The multisynth dividers are applied to the specified PLL output,
+    and are used to reduce the PLL output to a valid range (about
+    300kHz to 200MHz). The relationship can be seen in this formula, where
+    fVCO is the PLL output frequency and MSx is the multisynth
+    divider:
+
+        fOUT = fVCO / MSx
+
+    Valid multisynth dividers are 4, 6 or 8..2048 when using integers,
+    or any fractional values between 8 + 1/1,048,575 and 2048 + 0/1
+
+    The following formula is used for the fractional mode divider:
+
+        a + b / c
+
+    a = The integer value, which must be 4, 6 or 8..2048 in integer mode
+        (MSx_INT=1) or 8..2047 in fractional mode (MSx_INT=0).
+    b = The fractional numerator (0..1,048,575)
+    c = The fractional denominator (1..1,048,575)
+
+    @note   Try to use integers whenever possible to avoid clock jitter
+
+    @note   Multisynths 6 and 7 (CLK6/CLK7, on the Si5351A 20-pin and the
+            Si5351C) are integer only: div must be even and between 6 and
+            254, with num set to 0. Their R dividers share register 92.
+
+    @note   For output frequencies > 150MHz (up to 200MHz) the divider
+            must be 4 and the PLL adjusted to generate the frequency
+            (for example a PLL of 640MHz for a 160MHz output clock). A
+            div of 4 with num 0 sets MSx_DIVBY4 with P1 = 0, the
+            encoding the chip requires, and MSx_INT. setFrequency()
+            picks this path itself above 150MHz.
+
+    @note   Below about 300kHz (down to about 2.3kHz) the R divider must
+            divide further; see setupRdiv(). setFrequency() picks it
+            itself.
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setupMultisynth(uint8_t output, si5351PLL_t pllSource,
+                                       uint32_t div, uint32_t num,
+                                       uint32_t denom) {
+  SI5351_STATS_SCOPE(SI5351_STATS_MULTISYNTH);
+
+  /* Basic validation */
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER);       /* Channel range */
+  ASSERT(div > 3, ERROR_INVALIDPARAMETER);          /* Divider integer value */
+  ASSERT(div < 2049, ERROR_INVALIDPARAMETER);       /* Divider integer value */
+  /* Below 8 only the even integers 4 and 6 exist, in integer mode */
+  ASSERT((div >= 8) || ((num == 0) && !(div & 1)), ERROR_INVALIDPARAMETER);
+  ASSERT(denom > 0, ERROR_INVALIDPARAMETER);        /* Avoid divide by zero */
+  ASSERT(num <= 0xFFFFF, ERROR_INVALIDPARAMETER);   /* 20-bit limit */
+  ASSERT(denom <= 0xFFFFF, ERROR_INVALIDPARAMETER); /* 20-bit limit */
+
+  /* Make sure the requested PLL has been initialised */
+  if (pllSource == SI5351_PLL_A) {
+    ASSERT(m_si5351Config.plla_configured, ERROR_INVALIDPARAMETER);
   } else {
-    regval &= ~0x80;
+    ASSERT(m_si5351Config.pllb_configured, ERROR_INVALIDPARAMETER);
   }
-  ASSERT_STATUS(write8(SI5351_REGISTER_149_SPREAD_SPECTRUM_PARAMETERS, regval));
+
+  /* Output Multisynth Divider Equations
+   *
+   * where: a = div, b = num and c = denom
+   *
+   * P1 register is an 18-bit value using following formula:
+   *
+   * 	P1[17:0] = 128 * a + floor(128*(b/c)) - 512
+   *
+   * P2 register is a 20-bit value using the following formula:
+   *
+   * 	P2[19:0] = 128 * b - c * floor(128*(b/c))
+   *
+   * P3 register is a 20-bit value using the following formula:
+   *
+   * 	P3[19:0] = c
+   *
+   * See encodeDivider() for the register layout.
+   */
+
+  if (output >= 6) {
+    /* MS6/MS7 are a single register each: P1 is the even divider itself */
+    ASSERT((div <= 254) && (div >= 6) && !(div & 1), ERROR_INVALIDPARAMETER);
+    ASSERT(num == 0, ERROR_INVALIDPARAMETER);
+    uint8_t P1 = div;
+    ASSERT_STATUS(writeBurstDelta(
+        SI5351_REGISTER_90_MULTISYNTH6_PARAMETERS + (output - 6), &P1, 1));
+  } else {
+    /* Get the appropriate starting point for the PLL registers */
+    uint8_t baseaddr =
+        SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 + 8 * output;
+
+    /* Keep the R divider set by setupRdiv(), if we know it */
+    uint8_t rdivBits = 0;
+    if (isCached(baseaddr + 2))
+      rdivBits = m_regCache[baseaddr + 2] & 0x70;
+
+    /* Set the MSx config registers, only the bytes that change */
+    uint8_t regs[8];
+    encodeDivider(div, num, denom, regs);
+    regs[2] |= rdivBits;
+    if (div == 4)
+      regs[2] |= 0x0C; /* MSx_DIVBY4, with P1 = 0 */
+    ASSERT_STATUS(writeBurstDelta(baseaddr, regs, 8));
+  }
+
+  /* Configure the clk control and power the output up. This selects the
+     PLL and holds the MSx_INT bit that must match the new num; the drive
+     strength and inversion set with setOutputConfig() are kept */
+  uint8_t ctrlReg = SI5351_REGISTER_16_CLK0_CONTROL + output;
+  uint8_t regval;
+  ASSERT_STATUS(readCached(ctrlReg, &regval));
+  uint8_t clkControlReg = (regval & 0x13) | 0x0C; /* MSx as CLKx source */
+  if (pllSource == SI5351_PLL_B)
+    clkControlReg |= (1 << 5); /* Uses PLLB */
+  if (output >= 6) {
+    /* Bit 6 of CLK6/CLK7 control is FBA_INT/FBB_INT, it belongs to the
+       PLL and must be left alone */
+    clkControlReg |= regval & (1 << 6);
+  } else if (num == 0) {
+    clkControlReg |= (1 << 6); /* Integer mode */
+  }
+  ASSERT_STATUS(writeBurstDelta(ctrlReg, &clkControlReg, 1));
 
   return ERROR_NONE;
 }
 
-/* ---------------------------------------------------------------------- */
-/* PRUVATE FUNCTIONS                                                      */
-/* ---------------------------------------------------------------------- */
+/**************************************************************************/
+/*!
+    @brief  Sets an output to the requested frequency, choosing the PLL,
+            multisynth and R divider settings automatically
+
+    @param  output        The output channel to use (0..7)
+    @param  freq_milliHz  The output frequency in mHz (2.29kHz..200MHz,
+                          or 18.5kHz..150MHz on outputs 6 and 7)
+    @param  pllSource     The PLL feeding this output:
+                          - SI5351_PLL_A
+                          - SI5351_PLL_B
+    @param  error_milliHz Optional, receives the difference between the
+                          achieved and the requested frequency (mHz)
+
+    @section Frequency Solver
+
+    If pllSource is already configured its VCO frequency is kept, and
+    only the multisynth divider a + b / c and R divider are solved for.
+    A retune then costs a single multisynth burst and never disturbs
+    other outputs sharing the PLL. If the PLL is unconfigured, or the
+    output can't be reached from the current VCO, the multisynth is set
+    to an even integer (lowest jitter) and the VCO is moved instead,
+    which resets the PLL. Outputs 6 and 7 only have integer dividers, so
+    setting them always takes this second route. So does anything above
+    150MHz, with the multisynth in divide by 4 mode (MSx_DIVBY4) and the
+    VCO at four times the output: once the output is in that mode, a
+    retune only rewrites the PLL. setupMultisynth() skips the bytes
+    that don't change.
+
+    Fractions are found with a continued fraction (best rational
+    approximation) search limited to 20-bit denominators, using integer
+    math only. It finishes in a bounded number of steps (fewer than 40).
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setFrequency(uint8_t output, uint64_t freq_milliHz,
+                                    si5351PLL_t pllSource,
+                                    int64_t *error_milliHz) {
+  SI5351_STATS_SCOPE(SI5351_STATS_FREQUENCY);
+
+  const uint64_t vcoMin = (uint64_t)SI5351_VCO_MIN_HZ * 1000;
+  uint8_t rdiv;        /* R divider, as a power of two */
+  uint32_t a, b, c;    /* Multisynth divider a + b / c */
+  uint32_t divMax = (output >= 6) ? 254 : 2048; /* MS6/MS7 are 8 bits */
+  uint32_t divMin = (output >= 6) ? 6 : 4;      /* MS6/MS7 have no DIVBY4 */
+
+  /* Basic validation */
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER); /* Channel range */
+  ASSERT(freq_milliHz <= (uint64_t)SI5351_OUTPUT_MAX_HZ * 1000,
+         ERROR_INVALIDPARAMETER);
+  ASSERT(freq_milliHz * divMin <= (uint64_t)SI5351_VCO_MAX_HZ * 1000,
+         ERROR_INVALIDPARAMETER);
+  ASSERT(freq_milliHz * divMax * 128 >= vcoMin, ERROR_INVALIDPARAMETER);
+
+  /* Keep the current VCO if we know it, and solve the multisynth.
+     Otherwise move the VCO and run the multisynth in even integer mode */
+  if ((output >= 6) ||
+      !solveMultisynth(pllSource, freq_milliHz, 0, &a, &b, &c, &rdiv)) {
+    uint64_t target = freq_milliHz; /* Multisynth output frequency */
+    rdiv = 0;
+    while (target * divMax < vcoMin) {
+      target <<= 1;
+      rdiv++;
+    }
+
+    a = ((uint64_t)SI5351_VCO_MAX_HZ * 1000) / target;
+    if (a > divMax)
+      a = divMax;
+    a &= ~1; /* Even dividers only, 6 above 112.5MHz, 4 above 150MHz */
+    b = 0;
+    c = 1;
+
+    uint32_t mult, num, denom;
+    ASSERT(solvePLL(target * a, 0, &mult, &num, &denom),
+           ERROR_INVALIDPARAMETER);
+    ASSERT_STATUS(setupPLL(pllSource, mult, num, denom));
+  }
+
+  /* Only touch the R divider if it changes */
+  uint8_t rshift;
+  uint8_t rreg = rdivRegister(output, &rshift);
+  if (!isCached(rreg) || (((m_regCache[rreg] >> rshift) & 0x07) != rdiv)) {
+    ASSERT_STATUS(setupRdiv(output, (si5351RDiv_t)rdiv));
+  }
+  ASSERT_STATUS(setupMultisynth(output, pllSource, a, b, c));
+
+  /* Work out what we actually got */
+  if (error_milliHz) {
+    uint64_t vco;
+    ASSERT(vcoMicroHz(pllSource, &vco), ERROR_UNEXPECTEDVALUE);
+    uint64_t fout = (mulDiv(vco, c, a * c + b) / 1000) >> rdiv;
+    *error_milliHz = (int64_t)fout - (int64_t)freq_milliHz;
+  }
+
+  return ERROR_NONE;
+}
 
 /**************************************************************************/
 /*!
-    @brief  Writes a register and an 8 bit value over I2C
+    @brief  Plans PLL A/B and up to eight outputs together, favouring even
+            integer multisynth dividers and integer PLL multipliers
+
+    @param  requests  Eight requests, one per output (CLK0..CLK7); a zero
+                      frequency leaves that output out of the plan
+    @param  plan      Receives the plan, ready for setFrequencies()
+
+    @section Frequency Planner
+
+    The planner weighs up to SI5351_PLANNER_CANDIDATES VCO frequencies,
+    most promising first: the highest VCO that is an even integer
+    multiple of every pair of outputs, the highest one for each output
+    alone and then every integer multiple of the crystal. For each pair
+    of candidates (PLL A, PLL B) every output goes to a PLL it divides
+    down to with an even integer within its tolerance, or else to one it
+    reaches with a fractional divider. Outputs 6 and 7 only take even
+    integers. The pair with the most integer outputs wins, then the one
+    with the most integer PLLs; its dividers are then solved exactly and
+    checked against the tolerances, falling back to the next best pair
+    if one is missed.
+
+    Everything is integer math on fixed size arrays: at most
+    SI5351_PLANNER_CANDIDATES squared pairs of eight bit mask tests, and
+    a full solve only when a pair beats the best so far. Nothing is
+    written to the device. Outputs above 150MHz get divider 4
+    (MSx_DIVBY4) from a VCO at four times their frequency.
+
+    @return ERROR_NONE, or ERROR_INVALIDPARAMETER if no plan meets every
+            request
 */
 /**************************************************************************/
-err_t Adafruit_SI5351::write8(uint8_t reg, uint8_t value) {
-  uint8_t buffer[2] = {reg, value};
-  if (i2c_dev->write(buffer, 2)) {
-    return ERROR_NONE;
-  } else {
-    return ERROR_I2C_TRANSACTION;
+err_t Adafruit_SI5351::planFrequencies(const si5351OutputRequest_t *requests,
+                                       si5351FrequencyPlan_t *plan) {
+  const uint64_t vcoMin = (uint64_t)SI5351_VCO_MIN_HZ * 1000;
+  const uint64_t vcoMax = (uint64_t)SI5351_VCO_MAX_HZ * 1000;
+  uint64_t vco[SI5351_PLANNER_CANDIDATES];
+  uint64_t step[8]; /* Even integer VCO spacing of each output */
+  uint8_t intMask[SI5351_PLANNER_CANDIDATES];
+  uint8_t fracMask[SI5351_PLANNER_CANDIDATES];
+  uint8_t count = 0;
+  uint8_t wanted = 0;
+  uint64_t fxtal = crystalMilliHz();
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(requests && plan, ERROR_INVALIDPARAMETER);
+
+  for (uint8_t n = 0; n < 8; n++) {
+    uint64_t f = requests[n].freq_milliHz;
+    uint32_t divMax = (n >= 6) ? 254 : 2048;
+    if (f == 0)
+      continue;
+    ASSERT(f <= (uint64_t)SI5351_OUTPUT_MAX_HZ * 1000, ERROR_INVALIDPARAMETER);
+    ASSERT(f * divMax * 128 >= vcoMin, ERROR_INVALIDPARAMETER);
+    wanted |= (1 << n);
+
+    /* Even dividers with the R divider that covers the whole VCO range */
+    uint8_t r = 0;
+    while ((f << r) * divMax < vcoMax && r < 7)
+      r++;
+    step[n] = 2 * (f << r);
+  }
+  ASSERT(wanted, ERROR_INVALIDPARAMETER);
+
+  /* Candidate VCOs, without duplicates: shared by a pair of outputs, for
+     one output, then integer PLL multipliers */
+  for (uint8_t pass = 0; pass < 3; pass++) {
+    for (uint16_t k = 0; k < 64; k++) {
+      uint8_t i = k >> 3, j = k & 7;
+      uint64_t v = 0;
+      if (pass == 0) {
+        if ((i >= j) || !(wanted & (1 << i)) || !(wanted & (1 << j)))
+          continue;
+        uint64_t u = step[i] / gcd(step[i], step[j]);
+        if (u > vcoMax / step[j])
+          continue;
+        v = vcoMax / (u * step[j]) * (u * step[j]);
+      } else if (pass == 1) {
+        if ((k >= 8) || !(wanted & (1 << k)))
+          continue;
+        v = vcoMax / step[k] * step[k];
+      } else {
+        if (k > vcoMax / fxtal)
+          break;
+        v = fxtal * (vcoMax / fxtal - k);
+      }
+      if ((v < vcoMin) || (v > vcoMax))
+        continue;
+      bool known = false;
+      for (uint8_t m = 0; m < count; m++)
+        known |= (vco[m] == v);
+      if (!known && (count < SI5351_PLANNER_CANDIDATES))
+        vco[count++] = v;
+    }
+  }
+
+  /* Which outputs each candidate serves, in integer or fractional mode */
+  for (uint8_t m = 0; m < count; m++) {
+    uint32_t div;
+    uint8_t rdiv;
+    intMask[m] = fracMask[m] = 0;
+    for (uint8_t n = 0; n < 8; n++) {
+      if (!(wanted & (1 << n)))
+        continue;
+      if (planInteger(vco[m], &requests[n], n, &div, &rdiv))
+        intMask[m] |= (1 << n);
+      /* Fractional multisynths run from 8 to 2048 */
+      uint64_t f = requests[n].freq_milliHz;
+      for (rdiv = 0; (f << rdiv) * 2048 < vco[m] && rdiv < 7; rdiv++)
+        ;
+      if ((n < 6) && ((f << rdiv) * 8 <= vco[m]) &&
+          ((f << rdiv) * 2048 >= vco[m]))
+        fracMask[m] |= (1 << n);
+    }
   }
+
+  /* Score every pair, solving exactly only the ones that beat the best */
+  int16_t best = -1;
+  uint8_t bestA = 0, bestB = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    for (uint8_t j = i; j < count; j++) {
+      uint8_t onA = intMask[i];
+      uint8_t onB = intMask[j] & ~onA;
+      uint8_t frac = wanted & ~(onA | onB);
+      if ((frac & ~(fracMask[i] | fracMask[j])) || (frac & 0xC0))
+        continue;
+      onA |= frac & fracMask[i];
+      onB |= frac & ~fracMask[i];
+      if (i == j)
+        onB = 0;
+
+      int16_t score = 4 * __builtin_popcount((onA | onB) & ~frac);
+      if (onA && (vco[i] % fxtal == 0))
+        score++;
+      if (onB && (vco[j] % fxtal == 0))
+        score++;
+      if (score <= best)
+        continue;
+
+      uint64_t pair[2] = {vco[i], vco[j]};
+      uint8_t ints[2] = {(uint8_t)(onA & ~frac), (uint8_t)(onB & ~frac)};
+      uint8_t fracs[2] = {(uint8_t)(onA & frac), (uint8_t)(onB & frac)};
+      if (planBuild(pair, ints, fracs, requests, plan)) {
+        best = score;
+        bestA = i;
+        bestB = j;
+      }
+    }
+  }
+  ASSERT(best >= 0, ERROR_INVALIDPARAMETER);
+
+  /* Rebuild the winner, later pairs may have overwritten it */
+  uint8_t onA = intMask[bestA];
+  uint8_t onB = intMask[bestB] & ~onA;
+  uint8_t frac = wanted & ~(onA | onB);
+  onA |= frac & fracMask[bestA];
+  onB |= frac & ~fracMask[bestA];
+  if (bestA == bestB)
+    onB = 0;
+  uint64_t pair[2] = {vco[bestA], vco[bestB]};
+  uint8_t ints[2] = {(uint8_t)(onA & ~frac), (uint8_t)(onB & ~frac)};
+  uint8_t fracs[2] = {(uint8_t)(onA & frac), (uint8_t)(onB & frac)};
+  planBuild(pair, ints, fracs, requests, plan);
+
+  return ERROR_NONE;
 }
 
-err_t Adafruit_SI5351::writeN(uint8_t *data, uint8_t n) {
-  if (i2c_dev->write(data, n)) {
-    return ERROR_NONE;
-  } else {
-    return ERROR_I2C_TRANSACTION;
+/**************************************************************************/
+/*!
+    @brief  Finds the even integer divider and R divider that bring a VCO
+            within tolerance of a request
+    @return False if there is none
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::planInteger(uint64_t vco_milliHz,
+                                  const si5351OutputRequest_t *request,
+                                  uint8_t output, uint32_t *div,
+                                  uint8_t *rdiv) {
+  uint64_t f = request->freq_milliHz;
+  uint32_t divMax = (output >= 6) ? 254 : 2048;
+  uint32_t divMin = (output >= 6) ? 6 : 4; /* 4 is MSx_DIVBY4 */
+
+  for (*rdiv = 0; (f << *rdiv) * divMax < vco_milliHz; (*rdiv)++) {
+    if (*rdiv == 7)
+      return false;
   }
+
+  /* Nearest even divider */
+  uint64_t g = f << *rdiv;
+  uint64_t d = ((vco_milliHz + g) / (2 * g)) * 2;
+  if ((d < divMin) || (d > divMax))
+    return false;
+  *div = d;
+
+  uint64_t fout = (vco_milliHz / d) >> *rdiv;
+  uint64_t err = (fout > f) ? fout - f : f - fout;
+  return err <= request->tolerance_milliHz;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Reads an 8 bit value over I2C
+    @brief  Solves a plan exactly for the given PLL A/B VCOs and output
+            assignments (bit n: output n), checking every tolerance
+    @return False if a divider is out of range or a tolerance is missed
 */
 /**************************************************************************/
-err_t Adafruit_SI5351::read8(uint8_t reg, uint8_t *value) {
-  if (i2c_dev->write_then_read(&reg, 1, value, 1)) {
-    return ERROR_NONE;
-  } else {
-    return ERROR_I2C_TRANSACTION;
+bool Adafruit_SI5351::planBuild(const uint64_t *vco_milliHz,
+                                const uint8_t *intMask,
+                                const uint8_t *fracMask,
+                                const si5351OutputRequest_t *requests,
+                                si5351FrequencyPlan_t *plan) {
+  uint64_t fxtal = crystalMilliHz();
+  uint64_t vco[2];
+
+  plan->integerOutputs = 0;
+  plan->integerPLLs = 0;
+  for (uint8_t p = 0; p < 2; p++) {
+    si5351PlannedPLL_t *pll = &plan->pll[p];
+    pll->used = intMask[p] || fracMask[p];
+    pll->mult = pll->num = 0;
+    pll->denom = 1;
+    if (!pll->used)
+      continue;
+    if (!solvePLL(vco_milliHz[p], 0, &pll->mult, &pll->num, &pll->denom))
+      return false;
+    if (pll->num == 0)
+      plan->integerPLLs++;
+    vco[p] = mulDiv(fxtal, pll->mult * pll->denom + pll->num, pll->denom);
   }
+
+  for (uint8_t n = 0; n < 8; n++) {
+    si5351PlannedOutput_t *out = &plan->out[n];
+    uint8_t p = (intMask[1] | fracMask[1]) & (1 << n) ? 1 : 0;
+    si5351PlannedPLL_t *pll = &plan->pll[p];
+    out->used = (intMask[p] | fracMask[p]) & (1 << n);
+    out->integer = intMask[p] & (1 << n);
+    out->pll = p ? SI5351_PLL_B : SI5351_PLL_A;
+    out->error_milliHz = 0;
+    if (!out->used)
+      continue;
+
+    if (out->integer) {
+      if (!planInteger(vco_milliHz[p], &requests[n], n, &out->a,
+                       &out->rdiv))
+        return false;
+      out->b = 0;
+      out->c = 1;
+      plan->integerOutputs++;
+    } else if (!solveDivider(crystalMilliHz() *
+                                 (pll->mult * pll->denom + pll->num),
+                             pll->denom, requests[n].freq_milliHz, 0,
+                             &out->a, &out->b, &out->c, &out->rdiv)) {
+      return false;
+    }
+
+    uint64_t fout = mulDiv(vco[p], out->c, out->a * out->c + out->b) >>
+                    out->rdiv;
+    out->error_milliHz = (int64_t)fout - (int64_t)requests[n].freq_milliHz;
+    if ((uint64_t)(out->error_milliHz < 0 ? -out->error_milliHz
+                                          : out->error_milliHz) >
+        requests[n].tolerance_milliHz)
+      return false;
+  }
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Applies a plan from planFrequencies() as one transaction
+
+    @param  plan  The plan to apply
+
+    Both PLLs, the R dividers and the multisynths are staged and go out
+    in one commit(): outputs off, coalesced parameter bursts, one PLL
+    reset, outputs back on. If a transaction is already open (e.g. a
+    multi-device group), the plan is only staged into it.
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setFrequencies(const si5351FrequencyPlan_t *plan) {
+  SI5351_STATS_SCOPE(SI5351_STATS_FREQUENCY);
+
+  bool own = !m_inTransaction;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(plan, ERROR_INVALIDPARAMETER);
+
+  if (own)
+    ASSERT_STATUS(beginTransaction(true));
+
+  for (uint8_t p = 0; p < 2; p++) {
+    const si5351PlannedPLL_t *pll = &plan->pll[p];
+    if (pll->used)
+      ASSERT_STATUS(setupPLL(p ? SI5351_PLL_B : SI5351_PLL_A, pll->mult,
+                             pll->num, pll->denom));
+  }
+  for (uint8_t n = 0; n < 8; n++) {
+    const si5351PlannedOutput_t *out = &plan->out[n];
+    if (!out->used)
+      continue;
+    ASSERT_STATUS(setupRdiv(n, (si5351RDiv_t)out->rdiv));
+    ASSERT_STATUS(setupMultisynth(n, out->pll, out->a, out->b, out->c));
+  }
+
+  return own ? commit() : ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the VCO frequency of a PLL, computed exactly from the
+            programmed feedback divider (and the crystal calibration)
+            without touching the bus
+
+    @param  pll           The PLL to read, which must be one of the
+                          following:
+                          - SI5351_PLL_A
+                          - SI5351_PLL_B
+    @param  freq_milliHz  Receives the frequency, to the nearest mHz
+
+    @return ERROR_NONE, or ERROR_INVALIDPARAMETER if the PLL is not set up
+            or its registers are not cached
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::getPLLFrequency(si5351PLL_t pll,
+                                       uint64_t *freq_milliHz) {
+  uint64_t vco;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(freq_milliHz && vcoMicroHz(pll, &vco), ERROR_INVALIDPARAMETER);
+
+  *freq_milliHz = (vco + 500) / 1000;
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the frequency an output is programmed for, computed
+            exactly from the cached registers without touching the bus
+
+    @param  output        The output (0..7)
+    @param  freq_milliHz  Receives the frequency, to the nearest mHz
+
+    The divider chain is followed the way decodeRegisterImage() does:
+    CLKx_SRC (the crystal, or MS0/MS4 for CLK0..3/CLK4..7), MSx_SRC,
+    the P1/P2/P3 fields or MS6/MS7 integer, MSx_DIVBY4 and the R divider.
+    Whether the output is powered up or enabled makes no difference, so
+    a control loop can read a frequency before it turns the output on.
+
+    @return ERROR_NONE, ERROR_INVALIDPARAMETER if a register on the path
+            is not cached or its PLL is not set up, or
+            ERROR_UNEXPECTEDVALUE if the output runs from CLKIN or from
+            an invalid divider
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::getOutputFrequency(uint8_t output,
+                                          uint64_t *freq_milliHz) {
+  const uint8_t ctrl = SI5351_REGISTER_16_CLK0_CONTROL;
+  uint8_t rshift, ms = output;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT((output < 8) && freq_milliHz, ERROR_INVALIDPARAMETER);
+
+  uint8_t rreg = rdivRegister(output, &rshift);
+  ASSERT(isCached(ctrl + output) && isCached(rreg), ERROR_INVALIDPARAMETER);
+  uint8_t source = (m_regCache[ctrl + output] >> 2) & 0x03;
+  uint8_t rdiv = (m_regCache[rreg] >> rshift) & 0x07;
+
+  /* CLKx_SRC: 0 XTAL, 1 CLKIN, 2 MS0/MS4, 3 MSx */
+  ASSERT(source != 1, ERROR_UNEXPECTEDVALUE);
+  if (source == 0) {
+    *freq_milliHz = crystalMilliHz() >> rdiv;
+    return ERROR_NONE;
+  }
+  if (source == 2)
+    ms = (output < 4) ? 0 : 4;
+
+  uint8_t msreg = (ms >= 6)
+                      ? SI5351_REGISTER_90_MULTISYNTH6_PARAMETERS + ms - 6
+                      : SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 + 8 * ms;
+  ASSERT(isCached(ctrl + ms), ERROR_INVALIDPARAMETER);
+  for (uint8_t i = 0; i < ((ms >= 6) ? 1 : 8); i++)
+    ASSERT(isCached(msreg + i), ERROR_INVALIDPARAMETER);
+  si5351PLL_t pll =
+      (m_regCache[ctrl + ms] & (1 << 5)) ? SI5351_PLL_B : SI5351_PLL_A;
+
+  /* Divider as num / den */
+  uint64_t num;
+  uint32_t den;
+  if (ms >= 6) {
+    num = m_regCache[msreg];
+    den = 1;
+  } else if (((m_regCache[msreg + 2] >> 2) & 0x03) == 0x03) {
+    /* MSx_DIVBY4 */
+    num = 4;
+    den = 1;
+  } else {
+    uint32_t P1, P2, P3;
+    decodeDivider(&m_regCache[msreg], &P1, &P2, &P3);
+    num = (uint64_t)(P1 + 512) * P3 + P2;
+    den = 128 * P3;
+  }
+  ASSERT((den != 0) && (num >= 4ULL * den), ERROR_UNEXPECTEDVALUE);
+
+  uint64_t vco;
+  ASSERT(vcoMicroHz(pll, &vco), ERROR_INVALIDPARAMETER);
+  *freq_milliHz = (mulDivLong(vco, den, num << rdiv) + 500) / 1000;
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Precomputes the register images for a set of tones, so that
+            selectTone() can later switch between them at minimal cost
+
+    @param  table         The table to fill in
+    @param  tones         Caller supplied storage for count tones
+    @param  count         The number of tones (1..255)
+    @param  output        The output channel to use (0..5), which must
+                          already be set up with setupMultisynth() or
+                          setFrequency()
+    @param  freqs_milliHz The tone frequencies in mHz
+    @param  mode          Which divider the tones are made with:
+                          - SI5351_TONE_MULTISYNTH: the VCO stays put and
+                            each tone gets its own multisynth divider.
+                            Other outputs on the same PLL are unaffected.
+                          - SI5351_TONE_PLL: the multisynth divider (an
+                            integer, for low jitter) stays put and each
+                            tone moves the VCO. The PLL should not feed
+                            any other output.
+
+    @note   All tones must be reachable with the R divider currently
+            programmed for the output.
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::buildToneTable(si5351ToneTable_t *table,
+                                      si5351Tone_t *tones, uint8_t count,
+                                      uint8_t output,
+                                      const uint64_t *freqs_milliHz,
+                                      si5351ToneMode_t mode) {
+  SI5351_STATS_SCOPE(SI5351_STATS_TONE);
+
+  uint8_t ctrlreg = SI5351_REGISTER_16_CLK0_CONTROL + output;
+  uint8_t msreg = SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 + 8 * output;
+  uint32_t a, b, c;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 6, ERROR_INVALIDPARAMETER); /* Fractional capable */
+  ASSERT(count > 0, ERROR_INVALIDPARAMETER);
+  for (uint8_t i = 0; i < 8; i++) {
+    ASSERT(isCached(msreg + i), ERROR_DEVICENOTINITIALISED);
+  }
+  ASSERT(isCached(ctrlreg), ERROR_DEVICENOTINITIALISED);
+
+  si5351PLL_t pll = (m_regCache[ctrlreg] & (1 << 5)) ? SI5351_PLL_B
+                                                       : SI5351_PLL_A;
+  uint8_t rbits = m_regCache[msreg + 2] & 0x70;
+  bool fractional = false;
+
+  if (mode == SI5351_TONE_MULTISYNTH) {
+    table->baseaddr = msreg;
+    for (uint8_t t = 0; t < count; t++) {
+      uint8_t rdiv;
+      ASSERT(solveMultisynth(pll, freqs_milliHz[t], SI5351_FRAC_MAX, &a, &b,
+                             &c, &rdiv),
+             ERROR_INVALIDPARAMETER);
+      ASSERT((rdiv << 4) == rbits, ERROR_INVALIDPARAMETER);
+      encodeDivider(a, b, c, tones[t].regs);
+      tones[t].regs[2] |= rbits;
+      fractional |= (b != 0);
+    }
+  } else {
+    /* Current multisynth divider, which must be an integer */
+    uint32_t P1, P2, P3;
+    decodeDivider(&m_regCache[msreg], &P1, &P2, &P3);
+    ASSERT((P2 == 0) && ((P1 & 0x7F) == 0), ERROR_INVALIDPARAMETER);
+    uint32_t div = (P1 + 512) >> 7;
+
+    table->baseaddr = (pll == SI5351_PLL_A ? 26 : 34);
+    for (uint8_t t = 0; t < count; t++) {
+      uint64_t vco = (freqs_milliHz[t] << (rbits >> 4)) * div;
+      ASSERT(solvePLL(vco, SI5351_FRAC_MAX, &a, &b, &c),
+             ERROR_INVALIDPARAMETER);
+      encodeDivider(a, b, c, tones[t].regs);
+    }
+
+    /* FBA_INT/FBB_INT (CLK6/CLK7 control bit 6) would ignore P2 */
+    uint8_t fbctrl;
+    uint8_t fbreg = SI5351_REGISTER_22_CLK6_CONTROL +
+                    (pll == SI5351_PLL_A ? 0 : 1);
+    ASSERT_STATUS(readCached(fbreg, &fbctrl));
+    if (fbctrl & (1 << 6))
+      ASSERT_STATUS(write8(fbreg, fbctrl & ~(1 << 6)));
+  }
+
+  /* A fractional multisynth must not be left in integer mode */
+  if (fractional && (m_regCache[ctrlreg] & (1 << 6))) {
+    ASSERT_STATUS(write8(ctrlreg, m_regCache[ctrlreg] & ~(1 << 6)));
+  }
+
+  table->tones = tones;
+  table->count = count;
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Switches to a tone precomputed with buildToneTable()
+
+    @param  table The tone table
+    @param  tone  The tone to switch to (0..count-1)
+
+    Only the registers that differ from the current tone are written, in
+    one burst, and the PLL is never reset. All tones share the same 20-bit
+    denominator, so neighbouring tones usually differ in just the P2 low
+    bytes. The price is a tone resolution of 2^-20 of the divider (about
+    0.2Hz at 14MHz), rather than the exact fit setFrequency() finds.
+
+    There is no allocation or floating point math, so this can be called
+    from a timer ISR, as long as the I2C driver itself may be used from
+    interrupt context.
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::selectTone(const si5351ToneTable_t *table,
+                                  uint8_t tone) {
+  SI5351_STATS_SCOPE(SI5351_STATS_TONE);
+
+  ASSERT(tone < table->count, ERROR_INVALIDPARAMETER);
+
+  return writeBurstDelta(table->baseaddr, table->tones[tone].regs, 8);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enables or disables all clock outputs
+    @param  enabled Whether output is enabled
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::enableOutputs(bool enabled) {
+  SI5351_STATS_SCOPE(SI5351_STATS_OUTPUTS);
+
+  /* Make sure we've called init first */
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+
+  /* Enabled desired outputs (see Register 3) */
+  uint8_t mask = enabled ? 0x00 : 0xFF;
+  ASSERT_STATUS(
+      writeBurstDelta(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, &mask, 1));
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Starts a linear frequency sweep on an output
+
+    @param  output        The output channel to use (0..7)
+    @param  start_milliHz The first frequency in mHz
+    @param  stop_milliHz  The last frequency in mHz, above or below the
+                          first, and within a factor of 1.5 of it
+    @param  steps         The number of steps, so steps + 1 points
+    @param  dwell_us      How long poll() stays on each point (0 to go as
+                          fast as the bus allows)
+    @param  callback      Optional, called with the point index at the end
+                          of each dwell, e.g. to sample an ADC
+    @param  pllSource     The PLL to sweep, which should not feed any
+                          other output
+
+    @section Sweep Engine
+
+    The output multisynth is set to a fixed even integer and the sweep
+    moves the VCO, so the output frequency is a linear function of the
+    PLL feedback divider. With P3 fixed at 2^20 - 1, that divider is
+    (P1 + 512 + P2 / P3) / 128, and each step is a precomputed add to
+    P1/P2 with a Bresenham remainder, so the last point lands exactly on
+    stop_milliHz. Steps are never reset (the PLL tracks them), and only
+    the changed parameter bytes are written, usually one to three. That
+    is a single transaction of under 50 bit times, close to 10k steps/s
+    at 400kHz.
+
+    The first point is programmed right away. Call poll() from loop() to
+    pace the sweep by dwell_us, or call sweepStep() directly, e.g. when a
+    hardware timer flag fires (not from the ISR itself).
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::startSweep(uint8_t output, uint64_t start_milliHz,
+                                  uint64_t stop_milliHz, uint16_t steps,
+                                  uint32_t dwell_us,
+                                  si5351SweepCallback_t callback,
+                                  si5351PLL_t pllSource) {
+  SI5351_STATS_SCOPE(SI5351_STATS_SWEEP);
+
+  const uint64_t vcoMin = (uint64_t)SI5351_VCO_MIN_HZ * 1000;
+  const uint64_t vcoMax = (uint64_t)SI5351_VCO_MAX_HZ * 1000;
+  const uint32_t c = SI5351_FRAC_MAX;
+  uint32_t divMax = (output >= 6) ? 254 : 2048;
+  uint64_t fmin = start_milliHz < stop_milliHz ? start_milliHz : stop_milliHz;
+  uint64_t fmax = start_milliHz ^ stop_milliHz ^ fmin;
+  uint32_t a = 0;
+  uint8_t rdiv;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER); /* Channel range */
+  ASSERT(steps > 0, ERROR_INVALIDPARAMETER);
+  ASSERT(fmin > 0, ERROR_INVALIDPARAMETER);
+  ASSERT(fmax <= (uint64_t)SI5351_OUTPUT_MAX_HZ * 1000,
+         ERROR_INVALIDPARAMETER);
+
+  m_sweep.active = false;
+
+  /* One even divider that keeps both ends of the sweep in the VCO range */
+  for (rdiv = 0; rdiv < 8; rdiv++) {
+    a = vcoMax / (fmax << rdiv);
+    if (a > divMax)
+      a = divMax;
+    a &= ~1;
+    if ((a >= ((output >= 6) ? 6 : 4)) && ((fmin << rdiv) * a >= vcoMin))
+      break;
+  }
+  ASSERT(rdiv < 8, ERROR_INVALIDPARAMETER);
+
+  /* Feedback divider as X = (P1 + 512) * P3 + P2 = 128 * P3 * fVCO / fXTAL
+     (the crystal in Hz keeps the intermediate product in 64 bits) */
+  uint32_t fxtal = crystalMilliHz() / 1000;
+  uint64_t X0 = mulDiv((start_milliHz << rdiv) * a, 128 * c, fxtal) / 1000;
+  uint64_t X1 = mulDiv((stop_milliHz << rdiv) * a, 128 * c, fxtal) / 1000;
+  uint64_t span = (X1 > X0) ? X1 - X0 : X0 - X1;
+  uint64_t step = span / steps;
+
+  /* FBA_INT/FBB_INT (CLK6/CLK7 control bit 6) would ignore P2 */
+  uint8_t ctrl;
+  uint8_t ctrlreg = SI5351_REGISTER_22_CLK6_CONTROL +
+                    (pllSource == SI5351_PLL_A ? 0 : 1);
+  ASSERT_STATUS(readCached(ctrlreg, &ctrl));
+  if (ctrl & (1 << 6))
+    ASSERT_STATUS(write8(ctrlreg, ctrl & ~(1 << 6)));
+
+  /* Program the first point, then the divider that stays put */
+  uint8_t base = (pllSource == SI5351_PLL_A ? 26 : 34);
+  uint8_t regs[8];
+  m_sweep.P1 = X0 / c - 512;
+  m_sweep.P2 = X0 % c;
+  sweepRegisters(regs);
+  ASSERT_STATUS(writeBurst(base, regs, 8));
+  ASSERT_STATUS(resetPLL(pllSource));
+  recordPLL(pllSource);
+  ASSERT_STATUS(setupRdiv(output, (si5351RDiv_t)rdiv));
+  ASSERT_STATUS(setupMultisynth(output, pllSource, a, 0, 1));
+
+  m_sweep.down = (X1 < X0);
+  m_sweep.baseaddr = base;
+  m_sweep.steps = steps;
+  m_sweep.point = 0;
+  m_sweep.stepP1 = step / c;
+  m_sweep.stepP2 = step % c;
+  m_sweep.rem = span % steps;
+  m_sweep.err = 0;
+  m_sweep.dwell_us = dwell_us;
+  m_sweep.callback = callback;
+  m_sweep.last_us = micros();
+  m_sweep.active = true;
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Finishes the current sweep point (running the callback) and
+            moves on to the next, ending the sweep after the last point
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::sweepStep(void) {
+  SI5351_STATS_SCOPE(SI5351_STATS_SWEEP);
+
+  const uint32_t c = SI5351_FRAC_MAX;
+  uint8_t regs[8];
+
+  ASSERT(m_sweep.active, ERROR_UNEXPECTEDVALUE);
+
+  if (m_sweep.callback)
+    m_sweep.callback(m_sweep.point);
+  if (m_sweep.point == m_sweep.steps) {
+    m_sweep.active = false;
+    return ERROR_NONE;
+  }
+
+  /* X += step, with the remainder spread evenly over the steps */
+  uint32_t dP1 = m_sweep.stepP1;
+  uint32_t dP2 = m_sweep.stepP2;
+  m_sweep.err += m_sweep.rem;
+  if (m_sweep.err >= m_sweep.steps) {
+    m_sweep.err -= m_sweep.steps;
+    dP2++;
+  }
+  if (!m_sweep.down) {
+    m_sweep.P2 += dP2;
+    m_sweep.P1 += dP1;
+    if (m_sweep.P2 >= c) {
+      m_sweep.P2 -= c;
+      m_sweep.P1++;
+    }
+  } else {
+    m_sweep.P1 -= dP1;
+    if (m_sweep.P2 < dP2) {
+      m_sweep.P2 += c;
+      m_sweep.P1--;
+    }
+    m_sweep.P2 -= dP2;
+  }
+  m_sweep.point++;
+
+  sweepRegisters(regs);
+  err_t status = writeBurstDelta(m_sweep.baseaddr, regs, 8);
+  if (status != ERROR_NONE)
+    m_sweep.active = false;
+  m_sweep.last_us = micros();
+
+  return status;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stops a running sweep, leaving the output on its current point
+*/
+/**************************************************************************/
+void Adafruit_SI5351::stopSweep(void) { m_sweep.active = false; }
+
+/**************************************************************************/
+/*!
+    @brief  Sets the initial phase offsets of the outputs fed by a PLL, in
+            one burst followed by a single reset of that PLL
+
+    @param  pll             The PLL whose outputs are adjusted
+    @param  phase_centiDeg  Six phase offsets in hundredths of a degree
+                            (0..35999), one for each of outputs 0..5.
+                            Entries for outputs fed by the other PLL are
+                            ignored, and their offsets left as they are.
+
+    @section Phase Offset
+
+    CLKx_PHOFF delays an output in steps of a quarter VCO period, up to
+    127 steps. One output period is 4 * MSx steps, so:
+
+        CLKx_PHOFF = round(phase / 360 * 4 * MSx)
+
+    a 90 degree offset needs MSx <= 127 (output >= fVCO / 127). The
+    offset is relative to the common PLL, so it only holds between
+    outputs running at the same frequency from the same PLL, and only
+    until that PLL is reset or retuned. The R dividers must be 1.
+
+    @code
+    // 9MHz I/Q pair on CLK0/CLK1
+    const uint16_t iq[6] = {0, 9000, 0, 0, 0, 0};
+    clockgen.setupPLLInt(SI5351_PLL_A, 36);
+    clockgen.setupMultisynth(0, SI5351_PLL_A, 100, 0, 1);
+    clockgen.setupMultisynth(1, SI5351_PLL_A, 100, 0, 1);
+    clockgen.setPhaseOffsets(SI5351_PLL_A, iq);
+    @endcode
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setPhaseOffsets(si5351PLL_t pll,
+                                       const uint16_t *phase_centiDeg) {
+  SI5351_STATS_SCOPE(SI5351_STATS_PHASE);
+
+  const uint8_t phreg = SI5351_REGISTER_165_CLK0_INITIAL_PHASE_OFFSET;
+  uint8_t regs[6];
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+
+  for (uint8_t output = 0; output < 6; output++) {
+    uint8_t ctrlreg = SI5351_REGISTER_16_CLK0_CONTROL + output;
+    uint8_t msreg = SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 + 8 * output;
+    uint8_t ctrl;
+
+    ASSERT_STATUS(readCached(phreg + output, &regs[output]));
+    ASSERT_STATUS(readCached(ctrlreg, &ctrl));
+    if ((ctrl & (1 << 7)) ||
+        (((ctrl & (1 << 5)) ? SI5351_PLL_B : SI5351_PLL_A) != pll))
+      continue; /* Powered down or on the other PLL */
+    ASSERT(phase_centiDeg[output] < 36000, ERROR_INVALIDPARAMETER);
+
+    /* MSx = ((P1 + 512) * P3 + P2) / (128 * P3) */
+    uint8_t ms[8];
+    for (uint8_t i = 0; i < 8; i++)
+      ASSERT_STATUS(readCached(msreg + i, &ms[i]));
+    uint32_t P1, P2, P3;
+    decodeDivider(ms, &P1, &P2, &P3);
+    ASSERT(P3 > 0, ERROR_UNEXPECTEDVALUE);
+    uint64_t num = (uint64_t)phase_centiDeg[output] * 4 *
+                   ((uint64_t)(P1 + 512) * P3 + P2);
+    uint64_t den = (uint64_t)36000 * 128 * P3;
+    uint64_t steps = (num + den / 2) / den;
+
+    ASSERT(steps <= 0x7F, ERROR_INVALIDPARAMETER); /* 7-bit offset */
+    regs[output] = steps;
+  }
+
+  /* Burst mode: register address auto-increases */
+  ASSERT_STATUS(writeBurst(phreg, regs, 6));
+
+  /* The offsets only take effect when the PLL is reset */
+  return resetPLL(pll);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enables and disables all eight clock outputs in a single write
+    @param  mask  Bit n set enables CLKn, bit n clear disables it
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setOutputEnableMask(uint8_t mask) {
+  SI5351_STATS_SCOPE(SI5351_STATS_OUTPUTS);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+
+  /* Register 3 holds CLKx_DIS bits, so it takes the inverted mask */
+  uint8_t dis = ~mask;
+  return writeBurstDelta(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, &dis, 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enables or disables a single clock output (register 3)
+
+    @param  output   The output (0..7)
+    @param  enabled  Whether the output is enabled
+
+    The other outputs are left alone, and the output stops (in its
+    disable state, see setOutputDisableState()) or starts cleanly on a
+    clock edge, so this is glitch-free gating. It costs exactly one
+    register write, or none if the output is already in that state.
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::enableOutput(uint8_t output, bool enabled) {
+  SI5351_STATS_SCOPE(SI5351_STATS_OUTPUTS);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER);
+
+  return updateMaskBits(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1 << output,
+                        !enabled);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Powers an output driver up or down (CLKx_PDN)
+
+    @param  output     The output (0..7)
+    @param  poweredUp  Whether the driver is powered up
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setOutputPower(uint8_t output, bool poweredUp) {
+  SI5351_STATS_SCOPE(SI5351_STATS_OUTPUTS);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER);
+
+  return updateControl(1 << output, 1 << 7, poweredUp ? 0 : (1 << 7));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the drive strength of an output (CLKx_IDRV)
+
+    @param  output  The output (0..7)
+    @param  drive   One of SI5351_DRIVE_2MA .. SI5351_DRIVE_8MA
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setOutputDrive(uint8_t output, si5351Drive_t drive) {
+  SI5351_STATS_SCOPE(SI5351_STATS_OUTPUTS);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER);
+
+  return updateControl(1 << output, 0x03, drive & 0x03);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Inverts an output, or puts it back to normal (CLKx_INV)
+
+    @param  output    The output (0..7)
+    @param  inverted  Whether the output is inverted
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setOutputInvert(uint8_t output, bool inverted) {
+  SI5351_STATS_SCOPE(SI5351_STATS_OUTPUTS);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER);
+
+  return updateControl(1 << output, 1 << 4, inverted ? (1 << 4) : 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets what an output does while disabled (CLKx_DIS_STATE)
+
+    @param  output  The output (0..7)
+    @param  state   Low, high, high impedance or never disabled
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setOutputDisableState(uint8_t output,
+                                             si5351DisableState_t state) {
+  SI5351_STATS_SCOPE(SI5351_STATS_OUTPUTS);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(output < 8, ERROR_INVALIDPARAMETER);
+
+  return updateDisableState(1 << output, state);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Applies the same driver settings to several outputs at once
+
+    @param  mask    Bit n set applies the settings to CLKn
+    @param  config  The settings
+
+    Each register is only written if it changes, and only from its
+    first to its last changed byte: new drive, inversion and power
+    settings for any number of outputs are one burst over 16..23, and
+    the disable states one burst over 24..25. An output being disabled
+    is switched off first and one being enabled is switched on last, so
+    it never runs with half its new settings.
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setOutputConfig(uint8_t mask,
+                                       const si5351OutputConfig_t *config) {
+  SI5351_STATS_SCOPE(SI5351_STATS_OUTPUTS);
+
+  const uint8_t oeReg = SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(config, ERROR_INVALIDPARAMETER);
+
+  if (!config->enabled)
+    ASSERT_STATUS(updateMaskBits(oeReg, mask, true));
+  ASSERT_STATUS(updateControl(mask, 0x93,
+                              (config->poweredUp ? 0 : (1 << 7)) |
+                                  (config->inverted ? (1 << 4) : 0) |
+                                  (config->drive & 0x03)));
+  ASSERT_STATUS(updateDisableState(mask, config->disableState));
+  /* Register 9 bits stop the OEB pin from disabling an output */
+  ASSERT_STATUS(updateMaskBits(SI5351_REGISTER_9_OEB_PIN_ENABLE_CONTROL, mask,
+                               !config->oebPin));
+  if (config->enabled)
+    ASSERT_STATUS(updateMaskBits(oeReg, mask, false));
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the driver settings of an output, from the shadow
+            cache (each register is read once if it isn't cached)
+
+    @param  output  The output (0..7)
+    @param  config  Receives the settings
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::getOutputConfig(uint8_t output,
+                                       si5351OutputConfig_t *config) {
+  uint8_t ctrl, oe, oeb, dis;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT((output < 8) && config, ERROR_INVALIDPARAMETER);
+
+  ASSERT_STATUS(readCached(SI5351_REGISTER_16_CLK0_CONTROL + output, &ctrl));
+  ASSERT_STATUS(readCached(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, &oe));
+  ASSERT_STATUS(readCached(SI5351_REGISTER_9_OEB_PIN_ENABLE_CONTROL, &oeb));
+  ASSERT_STATUS(readCached(
+      SI5351_REGISTER_24_CLK3_0_DISABLE_STATE + (output >> 2), &dis));
+
+  config->drive = (si5351Drive_t)(ctrl & 0x03);
+  config->inverted = ctrl & (1 << 4);
+  config->poweredUp = !(ctrl & (1 << 7));
+  config->enabled = !(oe & (1 << output));
+  config->oebPin = !(oeb & (1 << output));
+  config->disableState =
+      (si5351DisableState_t)((dis >> (2 * (output & 3))) & 0x03);
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enables or disables spread spectrum
+    @param  enabled Whether spread spectrum output is enabled
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::enableSpreadSpectrum(bool enabled) {
+  SI5351_STATS_SCOPE(SI5351_STATS_SPREAD);
+
+  uint8_t regval;
+  ASSERT_STATUS(
+      readCached(SI5351_REGISTER_149_SPREAD_SPECTRUM_PARAMETERS, &regval));
+  if (enabled) {
+    regval |= 0x80;
+  } else {
+    regval &= ~0x80;
+  }
+  ASSERT_STATUS(write8(SI5351_REGISTER_149_SPREAD_SPECTRUM_PARAMETERS, regval));
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Programs and enables spread spectrum on PLL A
+
+    @param  spread_centiPercent The spread in hundredths of a percent:
+                                10..250 (0.1%..2.5%) for down spread, or
+                                10..150 (+/-0.1%..1.5%) for center spread
+    @param  mode                SI5351_SPREAD_DOWN or SI5351_SPREAD_CENTER
+
+    @section Spread Spectrum Parameters
+
+    Following AN619, with a 31.5kHz modulation rate, the PLL A ratio
+    a + b / c and the spread amplitude s:
+
+        SSUDP = floor(fXTAL / (4 * 31500))
+        Down:   SSDN = 64 * (a + b / c) * s / ((1 + s) * SSUDP)
+                SSUP = 0
+        Center: SSDN = 128 * (a + b / c) * s / ((1 + s) * SSUDP)
+                SSUP = 128 * (a + b / c) * s / ((1 - s) * SSUDP)
+
+    Each of SSDN/SSUP is stored as P1 + P2 / P3, with P3 = 32767. The
+    ratio is read back exactly from the PLL A registers, and everything
+    is computed with integer math. Registers 149..161 are written in one
+    13-byte burst.
+
+    @note   PLL A must be set up first, and this must be called again
+            after PLL A is retuned. enableSpreadSpectrum() turns the
+            spread off and on again without recomputing it.
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::setupSpreadSpectrum(uint16_t spread_centiPercent,
+                                           si5351SpreadMode_t mode) {
+  SI5351_STATS_SCOPE(SI5351_STATS_SPREAD);
+
+  uint64_t M;
+  uint32_t c;
+  uint16_t dnP1, dnP2, upP1 = 0, upP2 = 0, upP3 = 1;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(spread_centiPercent >= 10, ERROR_INVALIDPARAMETER);
+  ASSERT(spread_centiPercent <= (mode == SI5351_SPREAD_DOWN ? 250 : 150),
+         ERROR_INVALIDPARAMETER);
+  ASSERT(getPLLRatio(SI5351_PLL_A, &M, &c), ERROR_INVALIDPARAMETER);
+
+  /* Up/down step period, 12 bits */
+  uint32_t ssudp = m_si5351Config.crystalFreq / (4UL * 31500);
+
+  /* With s = spread_centiPercent / 10000 and a + b / c = M / c:
+     SSDN = k * M * spread / (c * (10000 + spread) * SSUDP) */
+  uint64_t num = M * spread_centiPercent;
+  uint64_t den = (uint64_t)c * ssudp;
+  if (mode == SI5351_SPREAD_DOWN) {
+    spreadStep(num * 64, den * (10000 + spread_centiPercent), &dnP1, &dnP2);
+  } else {
+    spreadStep(num * 128, den * (10000 + spread_centiPercent), &dnP1, &dnP2);
+    spreadStep(num * 128, den * (10000 - spread_centiPercent), &upP1, &upP2);
+    upP3 = 0x7FFF;
+  }
+
+  uint8_t regs[13];
+  regs[0] = 0x80 | ((dnP2 >> 8) & 0x7F); /* SSC_EN, SSDN_P2[14:8] */
+  regs[1] = dnP2 & 0xFF;
+  regs[2] = (mode == SI5351_SPREAD_CENTER ? 0x80 : 0x00) | 0x7F; /* P3 */
+  regs[3] = 0xFF;
+  regs[4] = dnP1 & 0xFF;
+  regs[5] = ((ssudp & 0x0F) << 4) | ((dnP1 >> 8) & 0x0F);
+  regs[6] = (ssudp >> 4) & 0xFF;
+  regs[7] = (upP2 >> 8) & 0x7F;
+  regs[8] = upP2 & 0xFF;
+  regs[9] = (upP3 >> 8) & 0x7F;
+  regs[10] = upP3 & 0xFF;
+  regs[11] = upP1 & 0xFF;
+  regs[12] = (upP1 >> 8) & 0x0F; /* SS_NCLK = 0 */
+
+  /* Burst mode: register address auto-increases */
+  return writeBurst(SI5351_REGISTER_149_SPREAD_SPECTRUM_PARAMETERS, regs,
+                    13);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Starts a batch of register changes
+
+    @param  disableOutputs  Whether commit() should disable all outputs
+                            while it applies the changes
+
+    @section Transactions
+
+    Until commit() is called, setupPLL(), setupMultisynth(), setupRdiv(),
+    setFrequency(), enableOutputs() and the other setters only stage
+    their register changes in the shadow cache. No I2C traffic happens,
+    except reads of registers the cache doesn't know yet.
+
+    @code
+    clockgen.beginTransaction();
+    clockgen.setupPLL(SI5351_PLL_A, 36, 0, 1);
+    clockgen.setupMultisynth(0, SI5351_PLL_A, 900, 0, 1);
+    clockgen.setupMultisynth(1, SI5351_PLL_A, 45, 1, 2);
+    clockgen.enableOutputs(true);
+    clockgen.commit();
+    @endcode
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::beginTransaction(bool disableOutputs) {
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(!m_inTransaction, ERROR_UNEXPECTEDVALUE);
+
+  m_inTransaction = true;
+  m_txDisableOutputs = disableOutputs;
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Applies the changes staged since beginTransaction()
+
+    Registers that were staged with the value they already hold are
+    skipped. The rest go out as the fewest contiguous bursts. Runs
+    separated by up to SI5351_BURST_GAP unchanged (cached) registers are
+    joined, since resending a few bytes is cheaper than another
+    transaction. PLL resets are merged into a single write after all the
+    parameters. The output enable register is written last, so outputs
+    switch once, onto the complete new configuration.
+
+    @return ERROR_NONE, or the error of the write that failed. The
+            registers that didn't go out are then dropped from the cache,
+            with the output enables, so the next setters rewrite them.
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::commit(void) {
+  SI5351_STATS_SCOPE(SI5351_STATS_COMMIT);
+
+  ASSERT_STATUS(commitParameters());
+  ASSERT_STATUS(commitResets());
+
+  return commitOutputs();
+}
+
+/**************************************************************************/
+/*!
+    @brief  First part of commit(): closes the transaction, disables the
+            outputs if asked to and sends the staged parameter registers
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::commitParameters(void) {
+  SI5351_STATS_SCOPE(SI5351_STATS_COMMIT);
+
+  const uint8_t oeReg = SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL;
+  bool anyDirty = false;
+
+  ASSERT(m_inTransaction, ERROR_UNEXPECTEDVALUE);
+  m_inTransaction = false;
+  m_txWriteOE = false;
+
+  for (uint8_t i = 0; i < sizeof(m_regDirty); i++) {
+    if (m_regDirty[i] & ((i == (oeReg >> 3)) ? ~(1 << (oeReg & 7)) : 0xFF))
+      anyDirty = true;
+  }
+  if (!anyDirty && !m_pendingReset && !isDirty(oeReg))
+    return ERROR_NONE;
+
+  /* Outputs go quiet while the dividers change, if asked to */
+  m_txWriteOE = isDirty(oeReg);
+  if (m_txWriteOE) {
+    m_txOE = m_regCache[oeReg];
+  } else if (m_txDisableOutputs && anyDirty) {
+    err_t err = readCached(oeReg, &m_txOE);
+    if (err != ERROR_NONE)
+      return abortCommit(err);
+    m_txWriteOE = true;
+  }
+  m_regDirty[oeReg >> 3] &= ~(1 << (oeReg & 7));
+  if (m_txWriteOE && m_txDisableOutputs && anyDirty) {
+    uint8_t off = 0xFF;
+    err_t err = issueBurst(oeReg, &off, 1);
+    if (err != ERROR_NONE)
+      return abortCommit(err);
+  }
+
+  /* Flush the staged runs */
+  uint8_t reg = 0;
+  while (reg < SI5351_REGISTER_CACHE_SIZE) {
+    if (!isDirty(reg)) {
+      reg++;
+      continue;
+    }
+
+    /* Grow the run, bridging short gaps of known, unchanged registers */
+    uint8_t last = reg;
+    uint8_t next = reg + 1;
+    while (next < SI5351_REGISTER_CACHE_SIZE) {
+      if (isDirty(next)) {
+        last = next++;
+      } else if ((next - last <= SI5351_BURST_GAP) && isCached(next) &&
+                 (next != oeReg)) {
+        next++;
+      } else {
+        break;
+      }
+    }
+
+    uint8_t len = last - reg + 1;
+    err_t err = issueBurst(reg, &m_regCache[reg], len);
+    if (err != ERROR_NONE)
+      return abortCommit(err);
+    for (uint8_t i = reg; i <= last; i++)
+      m_regDirty[i >> 3] &= ~(1 << (i & 7));
+    reg = last + 1;
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Second part of commit(): one reset for every PLL that asked
+            for one
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::commitResets(void) {
+  SI5351_STATS_SCOPE(SI5351_STATS_COMMIT);
+
+  if (m_pendingReset) {
+    uint8_t rst = m_pendingReset;
+    m_pendingReset = 0;
+    err_t err = issueBurst(SI5351_REGISTER_177_PLL_RESET, &rst, 1);
+    if (err != ERROR_NONE)
+      return abortCommit(err);
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Last part of commit(): writes the output enables
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::commitOutputs(void) {
+  SI5351_STATS_SCOPE(SI5351_STATS_COMMIT);
+
+  if (m_txWriteOE) {
+    m_txWriteOE = false;
+    err_t err = issueBurst(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, &m_txOE, 1);
+    if (err != ERROR_NONE)
+      return abortCommit(err);
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Cleans up after a failed commit(): the staged registers that
+            never went out, and the output enable register, are forgotten
+            so that they are re-read and rewritten on next use, and the
+            pending PLL reset and output enable write are dropped
+    @return err
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::abortCommit(err_t err) {
+  for (uint8_t reg = 0; reg < SI5351_REGISTER_CACHE_SIZE; reg++) {
+    if (isDirty(reg))
+      invalidateCache(reg, 1);
+  }
+  memset(m_regDirty, 0, sizeof(m_regDirty));
+  invalidateCache(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1);
+  m_pendingReset = 0;
+  m_txWriteOE = false;
+
+  return err;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Switches register writes between blocking I2C transfers and a
+            queue that poll() drains one burst at a time
+
+    With async writes enabled every API call returns as soon as its
+    registers are in the shadow cache and queued, so a retune never holds
+    up loop() for a whole transfer. Call poll() regularly (not from an
+    interrupt, Wire isn't reentrant) to push the queue out. A block that
+    is written again while still queued goes out only once, with the
+    latest values. The output enable (3) and PLL reset (177) registers
+    keep their order relative to everything queued around them, so
+    commit() still switches outputs onto a complete configuration.
+
+    @code
+    clockgen.enableAsyncWrites(true);
+    clockgen.setFrequency(0, 10000000000ULL); // Returns right away
+    ...
+    void loop() {
+      clockgen.poll();
+      ...
+    }
+    @endcode
+
+    @param  enabled   True to queue writes, false to go back to blocking
+                      writes (whatever is still queued is sent first)
+    @param  callback  Optional function told when the queue empties
+                      (ERROR_NONE) or a burst fails (the error)
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::enableAsyncWrites(bool enabled,
+                                         si5351WriteCallback_t callback) {
+  if (!enabled)
+    ASSERT_STATUS(flush());
+
+  m_writeCallback = callback;
+  m_async = enabled;
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Services the INTR pin if it fired (see enableLockInterrupt()),
+            else sends the oldest queued register burst, if there is one,
+            else applies the pending requests (see requestFrequency()),
+            or else advances a running sweep whose dwell time is up
+
+    The queue goes first, so requests that keep coming on every loop()
+    can't starve it: they wait, merged, until the last burst is out.
+    @return ERROR_NONE, or the error of the request or burst that failed
+            (it is dropped, and a failed burst's registers are re-read on
+            next use)
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::poll(void) {
+  if ((m_intPin >= 0) && m_si5351Interrupt)
+    return serviceInterrupt();
+
+  if (m_queueCount)
+    return sendQueued();
+
+  if (m_requestPending && !m_inTransaction)
+    return applyRequests();
+
+  /* Move a running sweep on once the point has dwelt */
+  if (m_sweep.active &&
+      ((uint32_t)(micros() - m_sweep.last_us) >= m_sweep.dwell_us))
+    return sweepStep();
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Blocks until every queued register burst has been sent
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::flush(void) {
+  while (m_queueCount)
+    ASSERT_STATUS(sendQueued());
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Asks for a new output frequency, applied by the next poll()
+
+    @param  output        The output (0..7)
+    @param  freq_milliHz  The frequency, as for setFrequency()
+    @param  pllSource     The PLL to run the output from
+
+    Nothing is computed or sent here, so this is safe to call from an
+    encoder or network handler as often as it likes. Each output and
+    PLL keeps only its newest request (frequency or divider), and poll()
+    solves and writes that one just once, however many came before it.
+    The bus never falls behind with stale values, and the newest value
+    is at most one poll() away. poll() applies all pending requests in
+    one transaction, without disabling the outputs: PLLs first, then the
+    outputs in order, with the parameter writes coalesced and one PLL
+    reset. With async writes on, that transaction only queues bursts,
+    and later poll() calls drain them before applying any newer
+    request; the newest value is then at most one queue drain away.
+
+    @return ERROR_NONE, or ERROR_INVALIDPARAMETER for a bad output
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::requestFrequency(uint8_t output, uint64_t freq_milliHz,
+                                        si5351PLL_t pllSource) {
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT((output < 8) && (freq_milliHz != 0), ERROR_INVALIDPARAMETER);
+
+  m_requests[output].freq_milliHz = freq_milliHz;
+  m_requests[output].pll = pllSource;
+  m_requestPending |= (1 << output);
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Asks for new multisynth settings (as for setupMultisynth()),
+            applied by the next poll(), replacing any pending request for
+            the output; see requestFrequency()
+    @return ERROR_NONE, or ERROR_INVALIDPARAMETER for a bad output
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::requestMultisynth(uint8_t output, si5351PLL_t pllSource,
+                                         uint32_t div, uint32_t num,
+                                         uint32_t denom) {
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT((output < 8) && (div <= 2048) && (denom != 0),
+         ERROR_INVALIDPARAMETER);
+
+  si5351Request_t *r = &m_requests[output];
+  r->freq_milliHz = 0;
+  r->div = div;
+  r->num = num;
+  r->denom = denom;
+  r->pll = pllSource;
+  m_requestPending |= (1 << output);
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Asks for new PLL settings (as for setupPLL()), applied by the
+            next poll() before any output request; see requestFrequency()
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::requestPLL(si5351PLL_t pll, uint8_t mult, uint32_t num,
+                                  uint32_t denom) {
+  uint8_t p = (pll == SI5351_PLL_A) ? 8 : 9;
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(denom != 0, ERROR_INVALIDPARAMETER);
+
+  si5351Request_t *r = &m_requests[p];
+  r->div = mult;
+  r->num = num;
+  r->denom = denom;
+  r->pll = pll;
+  m_requestPending |= (1 << p);
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Applies every pending request in one transaction, PLLs first
+    @return ERROR_NONE, or the first error (the requests after it stay
+            pending for the next poll())
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::applyRequests(void) {
+  ASSERT_STATUS(beginTransaction(false));
+
+  err_t err = ERROR_NONE;
+  for (uint8_t k = 0; (k < 10) && (err == ERROR_NONE); k++) {
+    uint8_t n = (k + 8) % 10; /* PLL A, PLL B, CLK0..CLK7 */
+    const si5351Request_t *r = &m_requests[n];
+    if (!(m_requestPending & (1 << n)))
+      continue;
+    m_requestPending &= ~(1 << n);
+    if (n >= 8)
+      err = setupPLL(r->pll, r->div, r->num, r->denom);
+    else if (r->freq_milliHz)
+      err = setFrequency(n, r->freq_milliHz, r->pll);
+    else
+      err = setupMultisynth(n, r->pll, r->div, r->num, r->denom);
+  }
+
+  /* Whatever staged cleanly still goes out */
+  err_t committed = commit();
+  return (err != ERROR_NONE) ? err : committed;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reloads the shadow register cache from the device
+
+    @note   Call this if something other than this driver (another bus
+            master, a brownout, ClockBuilder over a separate port) may
+            have changed the register map behind our back.
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::syncFromDevice(void) {
+  SI5351_STATS_SCOPE(SI5351_STATS_SYNC);
+
+  ASSERT(i2c_dev, ERROR_DEVICENOTINITIALISED);
+  ASSERT(!m_inTransaction, ERROR_UNEXPECTEDVALUE);
+  ASSERT_STATUS(flush());
+
+  invalidateCache();
+  return readRanges();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the registers syncFromDevice() mirrors into the shadow
+            cache, one burst per block. Nothing may be staged or queued.
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::readRanges(void) {
+  for (uint8_t r = 0; r < sizeof(m_si5351_sync_ranges) / 2; r++) {
+    uint8_t reg = m_si5351_sync_ranges[r][0];
+    uint8_t len = m_si5351_sync_ranges[r][1];
+    ASSERT_STATUS(readN(reg, &m_regCache[reg], len));
+    /* Volatile registers stay uncached */
+    cacheStore(reg, &m_regCache[reg], len);
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the live configuration into a register image, in a few
+            burst reads
+
+    @param  image  SI5351_REGISTER_CACHE_SIZE bytes receiving registers
+                   2..3, 9, 15..92, 149..170 and 177..183, e.g. for
+                   decodeRegisterImage(). All other registers read as 0.
+
+    The shadow cache is left alone, so the image shows what the device
+    holds even if it no longer matches what the driver wrote.
+
+    @return ERROR_NONE
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::snapshot(uint8_t *image) {
+  SI5351_STATS_SCOPE(SI5351_STATS_SYNC);
+
+  ASSERT(i2c_dev, ERROR_DEVICENOTINITIALISED);
+  ASSERT(image, ERROR_INVALIDPARAMETER);
+  ASSERT_STATUS(flush());
+
+  memset(image, 0, SI5351_REGISTER_CACHE_SIZE);
+  for (uint8_t r = 0; r < sizeof(m_si5351_sync_ranges) / 2; r++) {
+    uint8_t reg = m_si5351_sync_ranges[r][0];
+    ASSERT_STATUS(readN(reg, &image[reg], m_si5351_sync_ranges[r][1]));
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks that the device still holds the expected configuration,
+            e.g. from a watchdog after ESD events or brownouts
+
+    @param  plan      A register map (see loadRegisterMap()) to check the
+                      registers it sets against, or NULL to check
+                      registers 2..3, 9, 15..92, 149..170 and 177..183
+                      against the shadow cache
+    @param  mismatch  Receives the first register that differs, if any
+
+    Volatile registers (status, PLL reset and any marked with
+    setRegisterVolatile()) are read but never compared, nor are registers
+    the cache does not hold. Nothing is written and the cache is left
+    alone; call syncFromDevice() or reapply the plan to recover.
+
+    @return ERROR_NONE if everything matches, ERROR_UNEXPECTEDVALUE on the
+            first register that does not
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::verify(const uint8_t *plan, uint8_t *mismatch) {
+  SI5351_STATS_SCOPE(SI5351_STATS_SYNC);
+
+  ASSERT(m_si5351Config.initialised, ERROR_DEVICENOTINITIALISED);
+  ASSERT(!m_inTransaction, ERROR_UNEXPECTEDVALUE);
+  ASSERT_STATUS(flush());
+
+  if (!plan) {
+    for (uint8_t r = 0; r < sizeof(m_si5351_sync_ranges) / 2; r++)
+      ASSERT_STATUS(verifyRun(m_si5351_sync_ranges[r][0],
+                              m_si5351_sync_ranges[r][1], NULL, mismatch));
+    return ERROR_NONE;
+  }
+
+  while (true) {
+    uint8_t reg = pgm_read_byte(plan++);
+    uint8_t len = pgm_read_byte(plan++);
+    if (len == 0)
+      break;
+    ASSERT(reg + len <= SI5351_REGISTER_CACHE_SIZE, ERROR_ADDRESSOUTOFRANGE);
+    ASSERT_STATUS(verifyRun(reg, len, plan, mismatch));
+    plan += len;
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads len registers and compares them against values in flash
+            (PROGMEM), or against the shadow cache if values is NULL
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::verifyRun(uint8_t reg, uint8_t len,
+                                 const uint8_t *values, uint8_t *mismatch) {
+  uint8_t buf[32];
+
+  while (len) {
+    uint8_t n = (len > sizeof(buf)) ? sizeof(buf) : len;
+    ASSERT_STATUS(readN(reg, buf, n));
+    for (uint8_t i = 0; i < n; i++, reg++) {
+      uint8_t expected;
+      if (values)
+        expected = pgm_read_byte(values++);
+      else if (isCached(reg))
+        expected = m_regCache[reg];
+      else
+        continue;
+      if (m_regVolatile[reg >> 3] & (1 << (reg & 7)))
+        continue;
+      if (buf[i] != expected) {
+        if (mismatch)
+          *mismatch = reg;
+        return ERROR_UNEXPECTEDVALUE;
+      }
+    }
+    len -= n;
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Marks a register as volatile (always read from the device) or
+            cacheable. Registers 0, 1 and 177 are volatile by default.
+    @param  reg         The register address
+    @param  isVolatile  True if the cached copy must never be trusted
+*/
+/**************************************************************************/
+void Adafruit_SI5351::setRegisterVolatile(uint8_t reg, bool isVolatile) {
+  if (reg >= SI5351_REGISTER_CACHE_SIZE)
+    return;
+
+  if (isVolatile) {
+    m_regVolatile[reg >> 3] |= (1 << (reg & 7));
+    m_regValid[reg >> 3] &= ~(1 << (reg & 7));
+  } else {
+    m_regVolatile[reg >> 3] &= ~(1 << (reg & 7));
+  }
+}
+
+#ifdef SI5351_ENABLE_STATS
+/**************************************************************************/
+/*!
+    @brief  Clears all bus traffic and latency counters
+*/
+/**************************************************************************/
+void Adafruit_SI5351::resetStats(void) {
+  si5351Latency_t *lat[5] = {&m_stats.write8, &m_stats.writeN,
+                             &m_stats.read8, &m_stats.lock[0],
+                             &m_stats.lock[1]};
+
+  memset(&m_stats, 0, sizeof(m_stats));
+  for (uint8_t i = 0; i < 5; i++)
+    lat[i]->min_us = 0xFFFFFFFF;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Models how long some traffic keeps the bus busy
+
+    @param  stats  The traffic, e.g. getStats()->total
+    @param  busHz  The SCL frequency (100000, 400000, 1000000, ...)
+
+    Each transaction is a start, the address byte, the bytes written and a
+    stop. Reads add a repeated start and a second address byte. Every byte
+    takes 9 clocks with its ACK. Clock stretching and the gaps between
+    transactions, which depend on the MCU and its I2C driver, are left
+    out, so this is a lower bound to compare against measured time.
+
+    @return Modelled bus time in microseconds
+*/
+/**************************************************************************/
+uint32_t Adafruit_SI5351::busMicros(const si5351BusStats_t *stats,
+                                    uint32_t busHz) {
+  uint64_t bits = (uint64_t)stats->transactions * (1 + 9 + 1) +
+                  (uint64_t)stats->reads * (1 + 9) +
+                  (uint64_t)(stats->bytesWritten + stats->bytesRead) * 9;
+
+  return (bits * 1000000 + busHz / 2) / busHz;
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  Encodes a divider a + b / c into the P1/P2/P3 register image
+            shared by the PLL feedback and output multisynths, using
+            exact integer math (no floating point)
+
+    @param  a     The integer part of the divider
+    @param  b     The 20-bit numerator (0..1,048,575)
+    @param  c     The 20-bit denominator (1..1,048,575)
+    @param  regs  Eight bytes receiving the register values, in register
+                  order (MSx_P3[15:8] first). The R divider and DIVBY4 bits
+                  of regs[2] are left at zero for the caller to fill in.
+
+    @section Encoding
+
+        P1[17:0] = 128 * a + floor(128 * b / c) - 512
+        P2[19:0] = 128 * b - c * floor(128 * b / c)
+        P3[19:0] = c
+
+    128 * b fits in 27 bits for any 20-bit b, so 32-bit integer division
+    gives the exact floor() for the whole parameter range.
+*/
+/**************************************************************************/
+void Adafruit_SI5351::encodeDivider(uint32_t a, uint32_t b, uint32_t c,
+                                    uint8_t *regs) {
+  uint32_t f = (128 * b) / c;      /* floor(128 * b / c) */
+  uint32_t P1 = 128 * a + f - 512; /* Config register P1 */
+  uint32_t P2 = 128 * b - c * f;   /* Config register P2 */
+  uint32_t P3 = c;                 /* Config register P3 */
+
+  packDivider(P1, P2, P3, regs);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Packs raw P1/P2/P3 parameters into the eight register bytes of
+            a multisynth, the inverse of decodeDivider()
+
+    @param  P1    The 18-bit P1 parameter
+    @param  P2    The 20-bit P2 parameter
+    @param  P3    The 20-bit P3 parameter
+    @param  regs  Eight bytes receiving the register values, as for
+                  encodeDivider()
+*/
+/**************************************************************************/
+void Adafruit_SI5351::packDivider(uint32_t P1, uint32_t P2, uint32_t P3,
+                                  uint8_t *regs) {
+  /* The datasheet is a nightmare of typos and inconsistencies here! */
+  regs[0] = (P3 & 0x0000FF00) >> 8;
+  regs[1] = (P3 & 0x000000FF);
+  regs[2] = (P1 & 0x00030000) >> 16;
+  regs[3] = (P1 & 0x0000FF00) >> 8;
+  regs[4] = (P1 & 0x000000FF);
+  regs[5] = ((P3 & 0x000F0000) >> 12) | ((P2 & 0x000F0000) >> 16);
+  regs[6] = (P2 & 0x0000FF00) >> 8;
+  regs[7] = (P2 & 0x000000FF);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Unpacks P1/P2/P3 from an 8-byte divider register image, the
+            reverse of encodeDivider()
+*/
+/**************************************************************************/
+void Adafruit_SI5351::decodeDivider(const uint8_t *regs, uint32_t *P1,
+                                    uint32_t *P2, uint32_t *P3) {
+  *P1 = ((uint32_t)(regs[2] & 0x03) << 16) | ((uint32_t)regs[3] << 8) |
+        regs[4];
+  *P2 = ((uint32_t)(regs[5] & 0x0F) << 16) | ((uint32_t)regs[6] << 8) |
+        regs[7];
+  *P3 = ((uint32_t)(regs[5] & 0xF0) << 12) | ((uint32_t)regs[0] << 8) |
+        regs[1];
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decodes a register image back into exact PLL and output
+            frequencies, flagging anything out of range
+
+    @param  image    Registers 0..187 (SI5351_REGISTER_CACHE_SIZE bytes),
+                     e.g. captured from the bus or built by a planner
+    @param  xtal_Hz  The crystal frequency
+    @param  decoded  Receives the PLLs and all eight outputs
+
+    This reads the device the way the silicon does: the P1/P2/P3 fields
+    of both PLLs (26..41) and all multisynths (42..91), MSx_DIVBY4, the R
+    dividers (including R6/R7 in 92), CLKx_SRC/MSx_SRC/CLKx_PDN and the
+    enable mask in register 3. Dividers are kept as exact ratios, so
+    fVCO = xtal * pll.num / pll.den and
+    fOUT = fVCO / (divider.num / divider.den) / 2^rdiv, with no rounding.
+    It needs no device or object, so it can check solver output off-line.
+
+    Only powered up outputs, and the PLLs behind them, count towards the
+    returned flags, and only their frequencies are computed. Outputs fed
+    from CLKIN are flagged and not computed either.
+
+    @return The SI5351_IMAGE_* flags of everything in use, 0 if the image
+            is a valid configuration
+*/
+/**************************************************************************/
+uint8_t Adafruit_SI5351::decodeRegisterImage(const uint8_t *image,
+                                             uint32_t xtal_Hz,
+                                             si5351RegisterImage_t *decoded) {
+  const uint64_t vcoMin = (uint64_t)SI5351_VCO_MIN_HZ * 1000;
+  const uint64_t vcoMax = (uint64_t)SI5351_VCO_MAX_HZ * 1000;
+  const uint64_t outMax = 200000000000ULL; /* 200MHz, in mHz */
+  uint64_t vco_microHz[2] = {0, 0};         /* Extra digits for the outputs */
+  uint32_t P1, P2, P3;
+
+  decoded->flags = 0;
+
+  /* Feedback multisynths */
+  for (uint8_t pll = 0; pll < 2; pll++) {
+    si5351Ratio_t *fb = &decoded->pll[pll];
+    uint8_t *flags = &decoded->pllFlags[pll];
+
+    decodeDivider(&image[pll ? 34 : 26], &P1, &P2, &P3);
+    fb->num = (uint64_t)(P1 + 512) * P3 + P2;
+    fb->den = 128 * P3;
+    *flags = 0;
+    decoded->vco_milliHz[pll] = 0;
+    if ((P3 == 0) || (fb->num < 15ULL * fb->den) ||
+        (fb->num > 90ULL * fb->den)) {
+      *flags |= SI5351_IMAGE_PLL_RANGE;
+      continue;
+    }
+    /* PLLA_SRC/PLLB_SRC select CLKIN instead of the crystal */
+    if (image[SI5351_REGISTER_15_PLL_INPUT_SOURCE] & (1 << (2 + pll)))
+      *flags |= SI5351_IMAGE_UNKNOWN_INPUT;
+    vco_microHz[pll] = mulDiv(fb->num * 1000000, xtal_Hz, fb->den);
+    decoded->vco_milliHz[pll] = (vco_microHz[pll] + 500) / 1000;
+    if ((decoded->vco_milliHz[pll] < vcoMin) ||
+        (decoded->vco_milliHz[pll] > vcoMax))
+      *flags |= SI5351_IMAGE_VCO_RANGE;
+  }
+
+  /* Output multisynths, R dividers and clock control */
+  for (uint8_t n = 0; n < 8; n++) {
+    si5351OutputImage_t *out = &decoded->out[n];
+    uint8_t ctrl = image[SI5351_REGISTER_16_CLK0_CONTROL + n];
+    uint8_t ms = n;
+
+    out->poweredUp = !(ctrl & (1 << 7));
+    out->enabled = !(image[SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL] & (1 << n));
+    out->source = (ctrl >> 2) & 0x03;
+    out->freq_milliHz = 0;
+    out->flags = 0;
+    uint8_t rshift;
+    uint8_t rreg = rdivRegister(n, &rshift);
+    out->rdiv = (image[rreg] >> rshift) & 0x07;
+
+    /* CLKx_SRC = 2 borrows MS0 (CLK0..3) or MS4 (CLK4..7) */
+    if (out->source == 2)
+      ms = (n < 4) ? 0 : 4;
+    uint8_t msCtrl = image[SI5351_REGISTER_16_CLK0_CONTROL + ms];
+    out->pll = (msCtrl & (1 << 5)) ? SI5351_PLL_B : SI5351_PLL_A;
+
+    if (out->source == 1) {
+      out->flags |= SI5351_IMAGE_UNKNOWN_INPUT;
+    } else if (out->source == 0) {
+      /* Straight from the crystal, through the R divider only */
+      out->divider.num = 1;
+      out->divider.den = 1;
+      out->freq_milliHz = ((uint64_t)xtal_Hz * 1000) >> out->rdiv;
+    } else {
+      si5351Ratio_t *div = &out->divider;
+      if (ms >= 6) {
+        /* MS6/MS7: an 8-bit even integer divider */
+        uint8_t d = image[SI5351_REGISTER_90_MULTISYNTH6_PARAMETERS + ms - 6];
+        div->num = d;
+        div->den = 1;
+        if ((d < 6) || (d & 1))
+          out->flags |= SI5351_IMAGE_DIVIDER_RANGE;
+      } else {
+        const uint8_t *regs =
+            &image[SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 + 8 * ms];
+        decodeDivider(regs, &P1, &P2, &P3);
+        if (((regs[2] >> 2) & 0x03) == 0x03) {
+          /* MSx_DIVBY4 */
+          div->num = 4;
+          div->den = 1;
+        } else {
+          div->num = (uint64_t)(P1 + 512) * P3 + P2;
+          div->den = 128 * P3;
+        }
+        bool integer = (div->den != 0) && (div->num % div->den == 0);
+        if ((div->den == 0) ||
+            !((integer && ((div->num == 4ULL * div->den) ||
+                           (div->num == 6ULL * div->den))) ||
+              ((div->num >= 8ULL * div->den) &&
+               (div->num <= 2048ULL * div->den))))
+          out->flags |= SI5351_IMAGE_DIVIDER_RANGE;
+        if ((msCtrl & (1 << 6)) && !integer)
+          out->flags |= SI5351_IMAGE_INT_MISMATCH;
+      }
+
+      out->flags |= decoded->pllFlags[out->pll];
+      if (out->poweredUp &&
+          !(out->flags & (SI5351_IMAGE_DIVIDER_RANGE | SI5351_IMAGE_PLL_RANGE)))
+        out->freq_milliHz = (mulDivLong(vco_microHz[out->pll], div->den,
+                                        div->num << out->rdiv) +
+                             500) /
+                            1000;
+    }
+
+    if (out->freq_milliHz > outMax)
+      out->flags |= SI5351_IMAGE_OUTPUT_RANGE;
+    if (out->poweredUp)
+      decoded->flags |= out->flags;
+  }
+
+  return decoded->flags;
+}
+
+/* ---------------------------------------------------------------------- */
+/* PRUVATE FUNCTIONS                                                      */
+/* ---------------------------------------------------------------------- */
+
+/**************************************************************************/
+/*!
+    @brief  Writes a register and an 8 bit value over I2C
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::write8(uint8_t reg, uint8_t value) {
+#ifdef SI5351_ENABLE_STATS
+  uint32_t start = micros();
+  err_t status = writeBurst(reg, &value, 1);
+  recordLatency(&m_stats.write8, start);
+  return status;
+#else
+  return writeBurst(reg, &value, 1);
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a burst of registers over I2C, where data[0] is the
+            first register address and data[1..n-1] are the values
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::writeN(uint8_t *data, uint8_t n) {
+#ifdef SI5351_ENABLE_STATS
+  uint32_t start = micros();
+  err_t status = writeBurst(data[0], data + 1, n - 1);
+  recordLatency(&m_stats.writeN, start);
+  return status;
+#else
+  return writeBurst(data[0], data + 1, n - 1);
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes len consecutive registers starting at reg, or stages
+            them in the shadow cache when a transaction is open
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::writeBurst(uint8_t reg, const uint8_t *values,
+                                  uint8_t len) {
+  if (m_inTransaction)
+    return stageBurst(reg, values, len);
+
+  return issueBurst(reg, values, len);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends a burst now, or queues it for poll() in async mode
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::issueBurst(uint8_t reg, const uint8_t *values,
+                                  uint8_t len) {
+  if (m_async)
+    return queueBurst(reg, values, len);
+
+  return sendBurst(reg, values, len);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends len consecutive registers starting at reg to the device,
+            splitting the burst only where the I2C buffer is too small
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::sendBurst(uint8_t reg, const uint8_t *values,
+                                 uint8_t len) {
+  size_t maxChunk = i2c_dev->maxBufferSize() - 1; /* One byte for address */
+  uint8_t pos = 0;
+
+  while (pos < len) {
+    uint8_t addr = reg + pos;
+    uint8_t n = len - pos;
+    if (n > maxChunk)
+      n = maxChunk;
+    bool ok = i2c_dev->write(values + pos, n, true, &addr, 1);
+#ifdef SI5351_ENABLE_STATS
+    countTransaction(n + 1, 0, ok);
+#endif
+    if (!ok) {
+      /* No telling what made it to the device */
+      invalidateCache(addr, len - pos);
+      return ERROR_I2C_TRANSACTION;
+    }
+    cacheStore(addr, values + pos, n);
+#ifdef SI5351_ENABLE_STATS
+    if ((addr <= SI5351_REGISTER_177_PLL_RESET) &&
+        (addr + n > SI5351_REGISTER_177_PLL_RESET))
+      noteResets(values[pos + SI5351_REGISTER_177_PLL_RESET - addr]);
+#endif
+    pos += n;
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Records register changes in the shadow cache for commit(),
+            marking only the registers whose value actually changes
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::stageBurst(uint8_t reg, const uint8_t *values,
+                                  uint8_t len) {
+  ASSERT(reg + len <= SI5351_REGISTER_CACHE_SIZE, ERROR_ADDRESSOUTOFRANGE);
+
+  for (uint8_t i = 0; i < len; i++, reg++) {
+    if (reg == SI5351_REGISTER_177_PLL_RESET) {
+      /* Resets pile up and go out once, after the new parameters */
+      m_pendingReset |= values[i];
+      continue;
+    }
+    if (isCached(reg) && (m_regCache[reg] == values[i]))
+      continue;
+    m_regCache[reg] = values[i];
+    m_regDirty[reg >> 3] |= (1 << (reg & 7));
+    if (!(m_regVolatile[reg >> 3] & (1 << (reg & 7))))
+      m_regValid[reg >> 3] |= (1 << (reg & 7));
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Records a burst in the shadow cache and queues it for poll(),
+            merging it into a pending burst for the same registers
+
+    Queued bursts take their values from the cache when they go out, so a
+    burst already covering these registers simply sends the newer values.
+    Writes to the output enable and PLL reset registers carry their own
+    value and are never moved; merging only looks back as far as the last
+    of them.
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::queueBurst(uint8_t reg, const uint8_t *values,
+                                  uint8_t len) {
+  bool ordered = isOrderedWrite(reg, len);
+
+  ASSERT(reg + len <= SI5351_REGISTER_CACHE_SIZE, ERROR_ADDRESSOUTOFRANGE);
+
+  /* The cache holds the target state from now on */
+  cacheStore(reg, values, len);
+
+  for (uint8_t n = m_queueCount; n > 0; n--) {
+    si5351QueuedWrite_t *e =
+        &m_queue[(m_queueHead + n - 1) % SI5351_QUEUE_DEPTH];
+    bool eOrdered = isOrderedWrite(e->reg, e->len);
+
+    if (ordered || eOrdered) {
+      /* Back to back writes to an ordered register still merge */
+      if (ordered && eOrdered && (n == m_queueCount) && (e->reg == reg)) {
+        if (reg == SI5351_REGISTER_177_PLL_RESET)
+          e->value |= values[0];
+        else
+          e->value = values[0];
+        return ERROR_NONE;
+      }
+      break;
+    }
+    if ((e->reg <= reg) && (reg + len <= e->reg + e->len))
+      return ERROR_NONE; /* Goes out with the newer values */
+  }
+
+  /* Make room by sending the oldest burst now */
+  if (m_queueCount == SI5351_QUEUE_DEPTH)
+    ASSERT_STATUS(sendQueued());
+
+  si5351QueuedWrite_t *e =
+      &m_queue[(m_queueHead + m_queueCount) % SI5351_QUEUE_DEPTH];
+  e->reg = reg;
+  e->len = len;
+  e->value = values[0];
+  m_queueCount++;
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends the oldest queued burst and reports to the callback
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::sendQueued(void) {
+  SI5351_STATS_SCOPE(SI5351_STATS_QUEUE);
+
+  si5351QueuedWrite_t e = m_queue[m_queueHead];
+  bool ordered = isOrderedWrite(e.reg, e.len);
+  err_t status;
+
+  m_queueHead = (m_queueHead + 1) % SI5351_QUEUE_DEPTH;
+  m_queueCount--;
+
+  if (ordered) {
+    /* A later queued write may already own the cached value */
+    uint8_t target = m_regCache[e.reg];
+    status = sendBurst(e.reg, &e.value, 1);
+    if (status == ERROR_NONE)
+      m_regCache[e.reg] = target;
+  } else {
+    status = sendBurst(e.reg, &m_regCache[e.reg], e.len);
+  }
+
+  if (m_writeCallback && ((status != ERROR_NONE) || !m_queueCount))
+    m_writeCallback(status);
+
+  return status;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks if a burst is a single write to the output enable or PLL
+            reset register, which the queue must keep in order
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::isOrderedWrite(uint8_t reg, uint8_t len) {
+  return (len == 1) && ((reg == SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL) ||
+                        (reg == SI5351_REGISTER_177_PLL_RESET));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks if reg is part of a burst waiting in the write queue
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::isQueued(uint8_t reg) {
+  for (uint8_t n = 0; n < m_queueCount; n++) {
+    const si5351QueuedWrite_t *e =
+        &m_queue[(m_queueHead + n) % SI5351_QUEUE_DEPTH];
+    if ((e->reg <= reg) && (reg < e->reg + e->len))
+      return true;
+  }
+  return false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks if reg has a staged change waiting for commit()
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::isDirty(uint8_t reg) {
+  if (reg >= SI5351_REGISTER_CACHE_SIZE)
+    return false;
+  return m_regDirty[reg >> 3] & (1 << (reg & 7));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes only the part of a register block that differs from the
+            shadow cache, as a single burst from the first to the last
+            changed register (nothing at all if the block is unchanged)
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::writeBurstDelta(uint8_t reg, const uint8_t *values,
+                                       uint8_t len) {
+  uint8_t first = len, last = 0;
+
+  for (uint8_t i = 0; i < len; i++) {
+    if (!isCached(reg + i) || (m_regCache[reg + i] != values[i])) {
+      if (first == len)
+        first = i;
+      last = i;
+    }
+  }
+  if (first == len)
+    return ERROR_NONE;
+
+  return writeBurst(reg + first, values + first, last - first + 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Changes bits of the CLKx control registers (16..23) of every
+            output in mask, new = (old & ~clear) | set, as one delta burst
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::updateControl(uint8_t mask, uint8_t clear,
+                                     uint8_t set) {
+  uint8_t ctrl[8];
+  uint8_t first = 8, last = 0;
+
+  for (uint8_t n = 0; n < 8; n++) {
+    if (!(mask & (1 << n)))
+      continue;
+    if (first == 8)
+      first = n;
+    last = n;
+  }
+  if (first == 8)
+    return ERROR_NONE;
+
+  for (uint8_t n = first; n <= last; n++) {
+    ASSERT_STATUS(readCached(SI5351_REGISTER_16_CLK0_CONTROL + n, &ctrl[n]));
+    if (mask & (1 << n))
+      ctrl[n] = (ctrl[n] & ~clear) | set;
+  }
+
+  return writeBurstDelta(SI5351_REGISTER_16_CLK0_CONTROL + first, &ctrl[first],
+                         last - first + 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets CLKx_DIS_STATE (registers 24/25, two bits per output) of
+            every output in mask, as one delta burst
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::updateDisableState(uint8_t mask,
+                                          si5351DisableState_t state) {
+  const uint8_t reg = SI5351_REGISTER_24_CLK3_0_DISABLE_STATE;
+  uint8_t dis[2];
+  uint8_t first = (mask & 0x0F) ? 0 : 1;
+  uint8_t last = (mask & 0xF0) ? 1 : 0;
+
+  if (!mask)
+    return ERROR_NONE;
+
+  for (uint8_t i = first; i <= last; i++) {
+    ASSERT_STATUS(readCached(reg + i, &dis[i]));
+    for (uint8_t n = 0; n < 4; n++) {
+      if (mask & (1 << (4 * i + n)))
+        dis[i] = (dis[i] & ~(0x03 << (2 * n))) | ((state & 0x03) << (2 * n));
+    }
+  }
+
+  return writeBurstDelta(reg + first, &dis[first], last - first + 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets or clears the mask bits of a register (such as 3 or 9),
+            writing it only if it changes
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::updateMaskBits(uint8_t reg, uint8_t mask, bool set) {
+  uint8_t regval;
+
+  ASSERT_STATUS(readCached(reg, &regval));
+  regval = set ? (regval | mask) : (regval & ~mask);
+
+  return writeBurstDelta(reg, &regval, 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads an 8 bit value over I2C
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::read8(uint8_t reg, uint8_t *value) {
+  bool ok;
+#ifdef SI5351_ENABLE_STATS
+  uint32_t start = micros();
+  ok = i2c_dev->write_then_read(&reg, 1, value, 1);
+  recordLatency(&m_stats.read8, start);
+  countTransaction(1, 1, ok);
+#else
+  ok = i2c_dev->write_then_read(&reg, 1, value, 1);
+#endif
+  if (ok) {
+    /* Don't let the device value clobber a staged or queued change */
+    if (!isDirty(reg) && !isQueued(reg))
+      cacheStore(reg, value, 1);
+    return ERROR_NONE;
+  } else {
+    return ERROR_I2C_TRANSACTION;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads len consecutive registers starting at reg, using one
+            transaction per I2C buffer full. The cache is not updated.
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::readN(uint8_t reg, uint8_t *values, uint8_t len) {
+  size_t maxChunk = i2c_dev->maxBufferSize();
+  uint8_t pos = 0;
+
+  while (pos < len) {
+    uint8_t addr = reg + pos;
+    uint8_t n = len - pos;
+    if (n > maxChunk)
+      n = maxChunk;
+    bool ok = i2c_dev->write_then_read(&addr, 1, values + pos, n);
+#ifdef SI5351_ENABLE_STATS
+    countTransaction(1, n, ok);
+#endif
+    if (!ok)
+      return ERROR_I2C_TRANSACTION;
+    pos += n;
+  }
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns a register from the shadow cache, only going out on
+            the bus if the cached copy is missing or volatile
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351::readCached(uint8_t reg, uint8_t *value) {
+  if (isCached(reg)) {
+    *value = m_regCache[reg];
+    return ERROR_NONE;
+  }
+  return read8(reg, value);
+}
+
+#ifdef SI5351_ENABLE_STATS
+/**************************************************************************/
+/*!
+    @brief  Counts one I2C transaction, in total and against the API that
+            issued it
+*/
+/**************************************************************************/
+void Adafruit_SI5351::countTransaction(uint8_t written, uint8_t read,
+                                       bool ok) {
+  si5351BusStats_t *counters[2] = {&m_stats.total, &m_stats.api[m_statsApi]};
+
+  for (uint8_t i = 0; i < 2; i++) {
+    counters[i]->transactions++;
+    if (read)
+      counters[i]->reads++;
+    counters[i]->bytesWritten += written;
+    counters[i]->bytesRead += read;
+    if (!ok)
+      counters[i]->errors++;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Starts the lock timer of each PLL a register 177 write resets
+*/
+/**************************************************************************/
+void Adafruit_SI5351::noteResets(uint8_t value) {
+  uint32_t now = micros();
+
+  if (value & (1 << 5)) {
+    m_resetMicros[0] = now;
+    m_lockPending |= SI5351_STATUS_LOL_A;
+  }
+  if (value & (1 << 7)) {
+    m_resetMicros[1] = now;
+    m_lockPending |= SI5351_STATUS_LOL_B;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Counts the reset to lock time of each PLL register 0 shows as
+            locked for the first time since its reset
+*/
+/**************************************************************************/
+void Adafruit_SI5351::noteLockStatus(uint8_t status) {
+  uint8_t lol[2] = {SI5351_STATUS_LOL_A, SI5351_STATUS_LOL_B};
+
+  if (status & SI5351_STATUS_SYS_INIT)
+    return;
+  for (uint8_t p = 0; p < 2; p++) {
+    if ((m_lockPending & lol[p]) && !(status & lol[p])) {
+      recordLatency(&m_stats.lock[p], m_resetMicros[p]);
+      m_lockPending &= ~lol[p];
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Adds the time since start_us to a latency record
+*/
+/**************************************************************************/
+void Adafruit_SI5351::recordLatency(si5351Latency_t *lat, uint32_t start_us) {
+  uint32_t us = micros() - start_us;
+
+  lat->count++;
+  lat->total_us += us;
+  if (us < lat->min_us)
+    lat->min_us = us;
+  if (us > lat->max_us)
+    lat->max_us = us;
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  Finds the register and bit position of an output's R divider.
+            R0..R5 sit in their multisynth's third register, while R6 and
+            R7 are packed together in register 92.
+*/
+/**************************************************************************/
+uint8_t Adafruit_SI5351::rdivRegister(uint8_t output, uint8_t *shift) {
+  if (output < 6) {
+    *shift = 4;
+    return SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3 + 8 * output;
+  }
+
+  *shift = (output == 6) ? 0 : 4;
+  return SI5351_REGISTER_092_CLOCK_6_7_OUTPUT_DIVIDER;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Builds the PLL register image for the current sweep point
+*/
+/**************************************************************************/
+void Adafruit_SI5351::sweepRegisters(uint8_t *regs) {
+  packDivider(m_sweep.P1, m_sweep.P2, SI5351_FRAC_MAX, regs);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Splits a spread spectrum step num / den into the 12-bit integer
+            part P1 and the numerator P2 over a P3 of 32767
+*/
+/**************************************************************************/
+void Adafruit_SI5351::spreadStep(uint64_t num, uint64_t den, uint16_t *P1,
+                                 uint16_t *P2) {
+  *P1 = num / den;
+  *P2 = ((num % den) * 0x7FFF) / den;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the crystal frequency in mHz
+*/
+/**************************************************************************/
+uint64_t Adafruit_SI5351::crystalMilliHz(void) {
+  return (uint64_t)m_si5351Config.crystalFreq * 1000 +
+         (int64_t)m_si5351Config.crystalFreq * m_si5351Config.crystalPPB /
+             1000000;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decodes the programmed PLL multiplier from the shadow cache as
+            the exact ratio M / c, in lowest terms. For registers written
+            by encodeDivider() from a + b / c this is (a * c + b) / c, but
+            fineTunePLL() leaves an X / (128 * P3) that need not reduce
+            that far, so c can take up to 27 bits.
+    @return True if the PLL is configured and its registers are cached
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::getPLLRatio(si5351PLL_t pll, uint64_t *M, uint32_t *c) {
+  uint8_t base = (pll == SI5351_PLL_A ? 26 : 34);
+
+  if (!(pll == SI5351_PLL_A ? m_si5351Config.plla_configured
+                            : m_si5351Config.pllb_configured))
+    return false;
+  for (uint8_t i = 0; i < 8; i++) {
+    if (!isCached(base + i))
+      return false;
+  }
+
+  uint32_t P1, P2, P3;
+  decodeDivider(&m_regCache[base], &P1, &P2, &P3);
+  if (P3 == 0)
+    return false;
+
+  /* a + b / c = ((P1 + 512) * P3 + P2) / (128 * P3) */
+  uint64_t X = (uint64_t)(P1 + 512) * P3 + P2;
+  uint32_t g = gcd(X, 128 * P3);
+  *M = X / g;
+  *c = 128 * P3 / g;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Computes the exact VCO frequency of a PLL in uHz from its cached
+            feedback divider, fXTAL * M / c, rounded down
+    @return False if the PLL is not configured or its registers are not
+            cached
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::vcoMicroHz(si5351PLL_t pll, uint64_t *vco_microHz) {
+  uint64_t M, fxtal = crystalMilliHz() * 1000;
+  uint32_t c;
+
+  if (!getPLLRatio(pll, &M, &c))
+    return false;
+
+  /* M needs up to 34 bits, so split off its whole part */
+  *vco_microHz = fxtal * (M / c) + mulDivLong(fxtal, M % c, c);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Marks a PLL as configured and records its VCO frequency, as
+            programmed in the cached registers
+*/
+/**************************************************************************/
+void Adafruit_SI5351::recordPLL(si5351PLL_t pll) {
+  uint64_t vco = 0;
+
+  if (pll == SI5351_PLL_A)
+    m_si5351Config.plla_configured = true;
+  else
+    m_si5351Config.pllb_configured = true;
+  vcoMicroHz(pll, &vco);
+
+  /* Kept in Hz, the width of the config words savePlan() stores */
+  uint32_t freq = (vco + 500000) / 1000000;
+  if (pll == SI5351_PLL_A)
+    m_si5351Config.plla_freq = freq;
+  else
+    m_si5351Config.pllb_freq = freq;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Solves the multisynth divider a + b / c and R divider that give
+            freq_milliHz from the VCO frequency currently programmed.
+            c is fixedDenom, or the best fit if fixedDenom is 0.
+    @return False if the PLL is not configured or the frequency can't be
+            reached from its VCO
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::solveMultisynth(si5351PLL_t pll, uint64_t freq_milliHz,
+                                      uint32_t fixedDenom, uint32_t *a,
+                                      uint32_t *b, uint32_t *c,
+                                      uint8_t *rdiv) {
+  uint64_t pllM, vco;
+  uint32_t pllC;
+
+  if (!getPLLRatio(pll, &pllM, &pllC))
+    return false;
+
+  /* A 20-bit ratio is used as is. A fine tuned one is too wide for
+     fXTAL * pllM to fit in 64 bits, so take the VCO to the uHz */
+  if (pllC <= SI5351_FRAC_MAX)
+    return solveDivider(crystalMilliHz() * pllM, pllC, freq_milliHz,
+                        fixedDenom, a, b, c, rdiv);
+
+  vcoMicroHz(pll, &vco);
+  return solveDivider(vco, 1000, freq_milliHz, fixedDenom, a, b, c, rdiv);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Solves the multisynth divider a + b / c and R divider that give
+            freq_milliHz from a VCO at vcoNum / vcoDen mHz
+    @return False if the frequency can't be reached from that VCO
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::solveDivider(uint64_t vcoNum, uint32_t vcoDen,
+                                   uint64_t freq_milliHz, uint32_t fixedDenom,
+                                   uint32_t *a, uint32_t *b, uint32_t *c,
+                                   uint8_t *rdiv) {
+  uint64_t vco = vcoNum / vcoDen;
+
+  /* Smallest R divider that keeps the multisynth within 2048 */
+  uint64_t target = freq_milliHz;
+  *rdiv = 0;
+  while (target * 2048 < vco && *rdiv < 7) {
+    target <<= 1;
+    (*rdiv)++;
+  }
+
+  /* MSx = fVCO / target = vcoNum / (vcoDen * target) */
+  uint64_t den = (uint64_t)vcoDen * target;
+  uint64_t ms = vcoNum / den;
+  if ((ms < 8) || (ms > 2048))
+    return false;
+
+  *a = ms;
+  fitFraction(vcoNum % den, den, fixedDenom, b, c);
+  if (*b == *c) {
+    /* Fraction rounded up to a whole number */
+    (*a)++;
+    *b = 0;
+    *c = 1;
+  }
+
+  return (*a < 2048) || (*b == 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Solves the PLL multiplier mult + num / denom for a VCO
+            frequency given in mHz. denom is fixedDenom, or the best fit
+            if fixedDenom is 0.
+    @return False if the multiplier is out of range (15..90)
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::solvePLL(uint64_t vco_milliHz, uint32_t fixedDenom,
+                               uint32_t *mult, uint32_t *num,
+                               uint32_t *denom) {
+  uint64_t fxtal = crystalMilliHz();
+
+  /* fVCO = fXTAL * (mult + num / denom) */
+  *mult = vco_milliHz / fxtal;
+  fitFraction(vco_milliHz % fxtal, fxtal, fixedDenom, num, denom);
+  if (*num == *denom) {
+    (*mult)++;
+    *num = 0;
+    *denom = 1;
+  }
+
+  return (*mult > 14) && (*mult < 91);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Finds the fraction b / c closest to num / den (which must be
+            below 1) with c limited to 20 bits, walking the continued
+            fraction convergents and finishing with the best semiconvergent
+*/
+/**************************************************************************/
+void Adafruit_SI5351::bestRational(uint64_t num, uint64_t den, uint32_t *b,
+                                   uint32_t *c) {
+  uint64_t p0 = 0, q0 = 1; /* Convergent n - 2 */
+  uint64_t p1 = 1, q1 = 0; /* Convergent n - 1 */
+
+  while (den != 0) {
+    uint64_t a = num / den;
+    uint64_t rem = num % den;
+
+    if ((q1 != 0) && (a > (SI5351_FRAC_MAX - q0) / q1)) {
+      /* Next convergent is out of range: take the largest semiconvergent
+         if it beats the last convergent, which it does for k > a / 2 */
+      uint64_t k = (SI5351_FRAC_MAX - q0) / q1;
+      if (2 * k > a) {
+        p1 = p0 + k * p1;
+        q1 = q0 + k * q1;
+      }
+      break;
+    }
+
+    uint64_t p2 = p0 + a * p1;
+    uint64_t q2 = q0 + a * q1;
+    p0 = p1;
+    q0 = q1;
+    p1 = p2;
+    q1 = q2;
+    num = den;
+    den = rem;
+  }
+
+  *b = p1;
+  *c = q1;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Approximates num / den (which must be below 1) as b / c, with
+            c = fixedDenom, or the best rational fit if fixedDenom is 0
+*/
+/**************************************************************************/
+void Adafruit_SI5351::fitFraction(uint64_t num, uint64_t den,
+                                  uint32_t fixedDenom, uint32_t *b,
+                                  uint32_t *c) {
+  if (fixedDenom == 0) {
+    bestRational(num, den, b, c);
+    return;
+  }
+
+  /* Round(num * fixedDenom / den), by binary long multiplication so the
+     product never has to fit in 64 bits */
+  uint64_t q = 0, r = 0;
+  for (int8_t bit = 19; bit >= 0; bit--) {
+    q <<= 1;
+    r <<= 1;
+    if (fixedDenom & ((uint32_t)1 << bit))
+      r += num;
+    while (r >= den) {
+      r -= den;
+      q++;
+    }
+  }
+  if (2 * r >= den)
+    q++;
+
+  *b = q;
+  *c = fixedDenom;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Computes x * m / d without a 64-bit overflow, as long as
+            (x / d) * m fits in 64 bits
+*/
+/**************************************************************************/
+uint64_t Adafruit_SI5351::mulDiv(uint64_t x, uint32_t m, uint32_t d) {
+  return (x / d) * m + ((x % d) * m) / d;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Greatest common divisor, by Euclid's algorithm
+*/
+/**************************************************************************/
+uint64_t Adafruit_SI5351::gcd(uint64_t x, uint64_t y) {
+  while (y) {
+    uint64_t t = x % y;
+    x = y;
+    y = t;
+  }
+
+  return x;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Computes floor(x * m / d) for a 64-bit d, by binary long
+            multiplication so the product never has to fit in 64 bits
+            (d must be below 2^62)
+*/
+/**************************************************************************/
+uint64_t Adafruit_SI5351::mulDivLong(uint64_t x, uint32_t m, uint64_t d) {
+  uint64_t rem = x % d;
+  uint64_t q = 0, r = 0; /* (x % d) * m = q * d + r */
+
+  for (int8_t bit = 31; bit >= 0; bit--) {
+    q <<= 1;
+    r <<= 1;
+    if (r >= d) {
+      r -= d;
+      q++;
+    }
+    if (m & ((uint32_t)1 << bit))
+      r += rem;
+    if (r >= d) {
+      r -= d;
+      q++;
+    }
+  }
+
+  return (x / d) * m + q;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks if the shadow cache holds a trustworthy copy of reg
+*/
+/**************************************************************************/
+bool Adafruit_SI5351::isCached(uint8_t reg) {
+  if (reg >= SI5351_REGISTER_CACHE_SIZE)
+    return false;
+  return m_regValid[reg >> 3] & (1 << (reg & 7));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Records len register values starting at reg in the shadow cache
+*/
+/**************************************************************************/
+void Adafruit_SI5351::cacheStore(uint8_t reg, const uint8_t *values,
+                                 uint8_t len) {
+  for (uint8_t i = 0; i < len; i++, reg++) {
+    if (reg >= SI5351_REGISTER_CACHE_SIZE)
+      break;
+    m_regCache[reg] = values[i];
+    if (!(m_regVolatile[reg >> 3] & (1 << (reg & 7))))
+      m_regValid[reg >> 3] |= (1 << (reg & 7));
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Forgets everything in the shadow cache
+*/
+/**************************************************************************/
+void Adafruit_SI5351::invalidateCache(void) {
+  memset(m_regValid, 0, sizeof(m_regValid));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Forgets len registers starting at reg in the shadow cache
+*/
+/**************************************************************************/
+void Adafruit_SI5351::invalidateCache(uint8_t reg, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++, reg++) {
+    if (reg >= SI5351_REGISTER_CACHE_SIZE)
+      break;
+    m_regValid[reg >> 3] &= ~(1 << (reg & 7));
+  }
+}
+
+/**************************************************************************/
+/*!
+    Constructor
+*/
+/**************************************************************************/
+Adafruit_SI5351_Group::Adafruit_SI5351_Group(void) { m_count = 0; }
+
+/**************************************************************************/
+/*!
+    @brief  Adds a device (already started with begin()) to the group
+    @param  device  The device, e.g. one at 0x60 and one at 0x61
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351_Group::add(Adafruit_SI5351 *device) {
+  ASSERT(m_count < SI5351_GROUP_SIZE, ERROR_BUFFEROVERFLOW);
+  ASSERT(device, ERROR_INVALIDPARAMETER);
+
+  m_devices[m_count++] = device;
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Opens a transaction on every device in the group, after which
+            each device is set up through its own API as usual
+
+    @param  disableOutputs  Whether commit() should hold the outputs off
+                            while the parameters change
+    @return ERROR_NONE, or an error (with no transaction opened) if any
+            device is uninitialised or already in a transaction
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351_Group::beginTransaction(bool disableOutputs) {
+  for (uint8_t i = 0; i < m_count; i++) {
+    ASSERT(m_devices[i]->m_si5351Config.initialised,
+           ERROR_DEVICENOTINITIALISED);
+    ASSERT(!m_devices[i]->m_inTransaction, ERROR_UNEXPECTEDVALUE);
+  }
+  for (uint8_t i = 0; i < m_count; i++)
+    ASSERT_STATUS(m_devices[i]->beginTransaction(disableOutputs));
+
+  return ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Applies the changes staged on every device, so that the outputs
+            across all of them switch within a short, bounded window
+
+    The bulky part, every device's parameter bursts, is sent first while
+    the outputs are held. Then the PLL resets of all devices follow back
+    to back, and finally the output enable writes of all devices. Each of
+    those is a single 2-byte write, so at 400kHz the outputs of N devices
+    switch within about (N - 1) * 75us of each other, wherever they are
+    in the bus. Nothing else is given the bus in between, as long as the
+    devices are not in async mode (see Adafruit_SI5351::enableAsyncWrites).
+
+    @return ERROR_NONE, or the first error. A device whose parameters
+            failed to go out is left with its outputs held off.
+*/
+/**************************************************************************/
+err_t Adafruit_SI5351_Group::commit(void) {
+  bool ok[SI5351_GROUP_SIZE];
+  err_t result = ERROR_NONE;
+  err_t status;
+
+  /* Parameters first, the part that takes time */
+  for (uint8_t i = 0; i < m_count; i++) {
+    status = m_devices[i]->commitParameters();
+    ok[i] = (status == ERROR_NONE);
+    if (!ok[i] && (result == ERROR_NONE))
+      result = status;
+  }
+
+  /* Then the short writes that make the change visible, back to back */
+  for (uint8_t i = 0; i < m_count; i++) {
+    if (ok[i] && ((status = m_devices[i]->commitResets()) != ERROR_NONE)) {
+      ok[i] = false;
+      if (result == ERROR_NONE)
+        result = status;
+    }
+  }
+  for (uint8_t i = 0; i < m_count; i++) {
+    if (ok[i] && ((status = m_devices[i]->commitOutputs()) != ERROR_NONE)) {
+      if (result == ERROR_NONE)
+        result = status;
+    }
+  }
+
+  return result;
 }
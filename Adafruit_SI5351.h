@@ -19,124 +19,54 @@
 #define SI5351_ADDRESS (0x60) // Assumes ADDR pin = low
 #define SI5351_READBIT (0x01)
 
-/* Test setup from SI5351 ClockBuilder
- * -----------------------------------
- * XTAL:      25     MHz
- * Channel 0: 120.00 MHz
- * Channel 1: 12.00  MHz
- * Channel 2: 13.56  MHz
- */
-static const uint8_t m_si5351_regs_15to92_149to170[100][2] = {
-    {15, 0x00}, /* Input source = crystal for PLLA and PLLB */
-    {16, 0x4F}, /* CLK0 Control: 8mA drive, Multisynth 0 as CLK0 source, Clock
-                   not inverted, Source = PLLA, Multisynth 0 in integer mode,
-                   clock powered up */
-    {17, 0x4F}, /* CLK1 Control: 8mA drive, Multisynth 1 as CLK1 source, Clock
-                   not inverted, Source = PLLA, Multisynth 1 in integer mode,
-                   clock powered up */
-    {18, 0x6F}, /* CLK2 Control: 8mA drive, Multisynth 2 as CLK2 source, Clock
-                   not inverted, Source = PLLB, Multisynth 2 in integer mode,
-                   clock powered up */
-    {19, 0x80}, /* CLK3 Control: Not used ... clock powered down */
-    {20, 0x80}, /* CLK4 Control: Not used ... clock powered down */
-    {21, 0x80}, /* CLK5 Control: Not used ... clock powered down */
-    {22, 0x80}, /* CLK6 Control: Not used ... clock powered down */
-    {23, 0x80}, /* CLK7 Control: Not used ... clock powered down */
-    {24, 0x00}, /* Clock disable state 0..3 (low when disabled) */
-    {25, 0x00}, /* Clock disable state 4..7 (low when disabled) */
-    /* PLL_A Setup */
-    {26, 0x00},
-    {27, 0x05},
-    {28, 0x00},
-    {29, 0x0C},
-    {30, 0x66},
-    {31, 0x00},
-    {32, 0x00},
-    {33, 0x02},
-    /* PLL_B Setup */
-    {34, 0x02},
-    {35, 0x71},
-    {36, 0x00},
-    {37, 0x0C},
-    {38, 0x1A},
-    {39, 0x00},
-    {40, 0x00},
-    {41, 0x86},
-    /* Multisynth Setup */
-    {42, 0x00},
-    {43, 0x01},
-    {44, 0x00},
-    {45, 0x01},
-    {46, 0x00},
-    {47, 0x00},
-    {48, 0x00},
-    {49, 0x00},
-    {50, 0x00},
-    {51, 0x01},
-    {52, 0x00},
-    {53, 0x1C},
-    {54, 0x00},
-    {55, 0x00},
-    {56, 0x00},
-    {57, 0x00},
-    {58, 0x00},
-    {59, 0x01},
-    {60, 0x00},
-    {61, 0x18},
-    {62, 0x00},
-    {63, 0x00},
-    {64, 0x00},
-    {65, 0x00},
-    {66, 0x00},
-    {67, 0x00},
-    {68, 0x00},
-    {69, 0x00},
-    {70, 0x00},
-    {71, 0x00},
-    {72, 0x00},
-    {73, 0x00},
-    {74, 0x00},
-    {75, 0x00},
-    {76, 0x00},
-    {77, 0x00},
-    {78, 0x00},
-    {79, 0x00},
-    {80, 0x00},
-    {81, 0x00},
-    {82, 0x00},
-    {83, 0x00},
-    {84, 0x00},
-    {85, 0x00},
-    {86, 0x00},
-    {87, 0x00},
-    {88, 0x00},
-    {89, 0x00},
-    {90, 0x00},
-    {91, 0x00},
-    {92, 0x00},
-    /* Misc Config Register */
-    {149, 0x00},
-    {150, 0x00},
-    {151, 0x00},
-    {152, 0x00},
-    {153, 0x00},
-    {154, 0x00},
-    {155, 0x00},
-    {156, 0x00},
-    {157, 0x00},
-    {158, 0x00},
-    {159, 0x00},
-    {160, 0x00},
-    {161, 0x00},
-    {162, 0x00},
-    {163, 0x00},
-    {164, 0x00},
-    {165, 0x00},
-    {166, 0x00},
-    {167, 0x00},
-    {168, 0x00},
-    {169, 0x00},
-    {170, 0x00}};
+#define SI5351_REGISTER_CACHE_SIZE (188) //!< Registers 0..187 mirrored in RAM
+
+#define SI5351_VCO_MIN_HZ (600000000UL)    //!< Lowest valid VCO frequency
+#define SI5351_VCO_MAX_HZ (900000000UL)    //!< Highest valid VCO frequency
+#define SI5351_OUTPUT_MAX_HZ (200000000UL) //!< Highest setFrequency() output
+#define SI5351_FRAC_MAX (0xFFFFF)          //!< Largest 20-bit num/denom
+
+#ifndef SI5351_BURST_GAP
+#define SI5351_BURST_GAP (8) //!< Unchanged registers commit() may resend
+#endif
+
+#ifndef SI5351_IMPORT_BUFFER
+#define SI5351_IMPORT_BUFFER (16) //!< Longest burst loadRegisterFile() sends
+#endif
+
+#ifndef SI5351_PLANNER_CANDIDATES
+#define SI5351_PLANNER_CANDIDATES (48) //!< VCOs planFrequencies() weighs
+#endif
+
+#ifndef SI5351_GROUP_SIZE
+#define SI5351_GROUP_SIZE (4) //!< Devices an Adafruit_SI5351_Group holds
+#endif
+
+#ifndef SI5351_QUEUE_DEPTH
+#define SI5351_QUEUE_DEPTH (8) //!< Bursts the asynchronous write queue holds
+#endif
+
+/* Build with -DSI5351_ENABLE_STATS to count I2C transactions, bytes and
+ * errors per API and to time register accesses, for example to measure what
+ * a retune costs on the bus. Compiled out by default. */
+
+/* Register maps (see Adafruit_SI5351::loadRegisterMap) are byte arrays in
+ * flash made of runs: start register, run length, then that many values.
+ * A run length of zero ends the map. */
+#define SI5351_MAP_END 0x00, 0x00 //!< Terminates a register map
+
+/* Saved plans (see Adafruit_SI5351::savePlan) are a header, the driver
+ * state and then a register map as above, protected by a CRC-16 */
+#define SI5351_PLAN_VERSION (2)    //!< Bumped when the blob layout changes
+#define SI5351_PLAN_MAX_SIZE (346) //!< Enough for any saved plan
+
+/* Bits of the device status register 0 (see getDeviceStatus()), which are
+ * also the sticky bits in register 1 and the INTR masks in register 2 */
+#define SI5351_STATUS_SYS_INIT (0x80)  //!< Device is still initialising
+#define SI5351_STATUS_LOL_B (0x40)     //!< PLL B has lost lock
+#define SI5351_STATUS_LOL_A (0x20)     //!< PLL A has lost lock
+#define SI5351_STATUS_LOS_CLKIN (0x10) //!< CLKIN signal lost (Si5351C)
+#define SI5351_STATUS_LOS_XTAL (0x08)  //!< Crystal signal lost
 
 /* See http://www.silabs.com/Support%20Documents/TechnicalDocs/AN619.pdf for
  * registers 26..41 */
@@ -252,18 +182,269 @@ typedef enum {
   SI5351_R_DIV_128 = 7,
 } si5351RDiv_t;
 
+typedef enum {
+  SI5351_TONE_MULTISYNTH = 0, //!< Tones vary the output multisynth
+  SI5351_TONE_PLL,            //!< Tones vary the PLL feeding the output
+} si5351ToneMode_t;
+
+typedef enum {
+  SI5351_SPREAD_DOWN = 0, //!< VCO spreads below its nominal frequency
+  SI5351_SPREAD_CENTER,   //!< VCO spreads around its nominal frequency
+} si5351SpreadMode_t;
+
+typedef enum {
+  SI5351_DRIVE_2MA = 0, //!< Output driver strength, CLKx_IDRV
+  SI5351_DRIVE_4MA,
+  SI5351_DRIVE_6MA,
+  SI5351_DRIVE_8MA,
+} si5351Drive_t;
+
+typedef enum {
+  SI5351_DISABLE_LOW = 0, //!< Disabled output state, CLKx_DIS_STATE
+  SI5351_DISABLE_HIGH,
+  SI5351_DISABLE_HIGH_Z,
+  SI5351_DISABLE_NEVER, //!< The output can't be disabled
+} si5351DisableState_t;
+
+/*!
+ * @brief Driver settings of an output (see setOutputConfig())
+ */
+typedef struct {
+  si5351Drive_t drive;               //!< Drive strength (CLKx_IDRV)
+  bool inverted;                     //!< Output inverted (CLKx_INV)
+  bool poweredUp;                    //!< Driver powered up (CLKx_PDN clear)
+  bool enabled;                      //!< Output enabled (register 3)
+  bool oebPin;                       //!< The OEB pin can disable it (reg 9)
+  si5351DisableState_t disableState; //!< State while disabled (24/25)
+} si5351OutputConfig_t;
+
+/*!
+ * @brief Precomputed divider registers for one tone (see buildToneTable)
+ */
+typedef struct {
+  uint8_t regs[8]; //!< P1/P2/P3 register image, in register order
+} si5351Tone_t;
+
+/*!
+ * @brief A set of tones that selectTone() switches between
+ */
+typedef struct {
+  si5351Tone_t *tones; //!< Caller supplied storage, one entry per tone
+  uint8_t count;       //!< Number of tones
+  uint8_t baseaddr;    //!< First register of the divider the tones rewrite
+} si5351ToneTable_t;
+
+/* Problems decodeRegisterImage() can flag */
+#define SI5351_IMAGE_PLL_RANGE (0x01)     //!< Feedback divider not 15..90
+#define SI5351_IMAGE_VCO_RANGE (0x02)     //!< VCO outside 600..900MHz
+#define SI5351_IMAGE_DIVIDER_RANGE (0x04) //!< Invalid output multisynth
+#define SI5351_IMAGE_INT_MISMATCH (0x08)  //!< MSx_INT set on a fraction
+#define SI5351_IMAGE_OUTPUT_RANGE (0x10)  //!< Output above 200MHz
+#define SI5351_IMAGE_UNKNOWN_INPUT (0x20) //!< Fed from CLKIN, not simulated
+
+/*!
+ * @brief An exact divider value num / den, as decoded from P1/P2/P3
+ */
+typedef struct {
+  uint64_t num; //!< (P1 + 512) * P3 + P2
+  uint32_t den; //!< 128 * P3
+} si5351Ratio_t;
+
+/*!
+ * @brief One output as decoded by decodeRegisterImage()
+ */
+typedef struct {
+  bool poweredUp;        //!< CLKx_PDN clear
+  bool enabled;          //!< CLKx_DIS clear in register 3
+  si5351PLL_t pll;       //!< PLL behind the multisynth (MSx_SRC)
+  uint8_t source;        //!< CLKx_SRC: 0 XTAL, 1 CLKIN, 2 MS0/MS4, 3 MSx
+  si5351Ratio_t divider; //!< Output multisynth divider (1 for XTAL)
+  uint8_t rdiv;          //!< R divider, as a power of two
+  uint64_t freq_milliHz; //!< Output frequency, to the nearest mHz
+  uint8_t flags;         //!< SI5351_IMAGE_* problems with this output
+} si5351OutputImage_t;
+
+/*!
+ * @brief A whole register image as decoded by decodeRegisterImage()
+ */
+typedef struct {
+  si5351Ratio_t pll[2];       //!< PLL A/B feedback dividers
+  uint64_t vco_milliHz[2];    //!< PLL A/B VCO frequencies, nearest mHz
+  uint8_t pllFlags[2];        //!< SI5351_IMAGE_* problems with each PLL
+  si5351OutputImage_t out[8]; //!< CLK0..CLK7
+  uint8_t flags;              //!< Problems with anything in use
+} si5351RegisterImage_t;
+
+/*!
+ * @brief One output wanted from planFrequencies()
+ */
+typedef struct {
+  uint64_t freq_milliHz;      //!< Frequency wanted, 0 to leave the output out
+  uint32_t tolerance_milliHz; //!< Largest error that is acceptable
+} si5351OutputRequest_t;
+
+/*!
+ * @brief PLL settings chosen by planFrequencies()
+ */
+typedef struct {
+  bool used;      //!< Some output of the plan runs from this PLL
+  uint32_t mult;  //!< Integer multiplier
+  uint32_t num;   //!< Fractional numerator, 0 in integer mode
+  uint32_t denom; //!< Fractional denominator
+} si5351PlannedPLL_t;
+
+/*!
+ * @brief Output settings chosen by planFrequencies()
+ */
+typedef struct {
+  bool used;             //!< The output is part of the plan
+  bool integer;          //!< Even integer multisynth divider (MS_INT)
+  si5351PLL_t pll;       //!< PLL feeding the output
+  uint32_t a;            //!< Multisynth divider a + b / c
+  uint32_t b;            //!< Multisynth numerator
+  uint32_t c;            //!< Multisynth denominator
+  uint8_t rdiv;          //!< R divider, as a power of two
+  int64_t error_milliHz; //!< Achieved minus requested frequency
+} si5351PlannedOutput_t;
+
+/*!
+ * @brief A complete multi-output plan, see planFrequencies()
+ */
+typedef struct {
+  si5351PlannedPLL_t pll[2];    //!< PLL A/B
+  si5351PlannedOutput_t out[8]; //!< CLK0..CLK7
+  uint8_t integerOutputs;       //!< Outputs on even integer dividers
+  uint8_t integerPLLs;          //!< Used PLLs with integer multipliers
+} si5351FrequencyPlan_t;
+
+/*!
+ * @brief Called by sweepStep() once a sweep point has dwelt, with its index
+ */
+typedef void (*si5351SweepCallback_t)(uint16_t point);
+
+/*!
+ * @brief State of a running frequency sweep (see startSweep)
+ */
+typedef struct {
+  bool active;                    //!< A sweep is in progress
+  bool down;                      //!< Sweeping towards lower frequencies
+  uint8_t baseaddr;               //!< First register of the swept PLL
+  uint16_t steps;                 //!< Number of steps (points - 1)
+  uint16_t point;                 //!< Current point (0..steps)
+  uint32_t P1;                    //!< Current PLL P1
+  uint32_t P2;                    //!< Current PLL P2, over SI5351_FRAC_MAX
+  uint32_t stepP1;                //!< P1 part of the per-step increment
+  uint32_t stepP2;                //!< P2 part of the per-step increment
+  uint16_t rem;                   //!< Increment remainder, in 1/steps
+  uint16_t err;                   //!< Accumulated remainder, in 1/steps
+  uint32_t dwell_us;              //!< Time spent on each point
+  uint32_t last_us;               //!< micros() when the point was set
+  si5351SweepCallback_t callback; //!< Per-point callback, or NULL
+} si5351Sweep_t;
+
+#ifdef SI5351_ENABLE_STATS
+/*!
+ * @brief Public API groups that bus traffic is counted against. Traffic is
+ * charged to the outermost call, so a setFrequency() that reprograms the PLL
+ * counts as SI5351_STATS_FREQUENCY.
+ */
+typedef enum {
+  SI5351_STATS_OTHER = 0,  //!< Not issued from a public API
+  SI5351_STATS_BEGIN,      //!< begin(), setClockBuilderData(), register maps
+  SI5351_STATS_PLL,        //!< setupPLL(), resetPLL()
+  SI5351_STATS_MULTISYNTH, //!< setupMultisynth(), setupRdiv()
+  SI5351_STATS_FREQUENCY,  //!< setFrequency()
+  SI5351_STATS_TONE,       //!< buildToneTable(), selectTone()
+  SI5351_STATS_SWEEP,      //!< startSweep(), sweepStep()
+  SI5351_STATS_PHASE,      //!< setPhaseOffsets()
+  SI5351_STATS_SPREAD,     //!< Spread spectrum setup
+  SI5351_STATS_OUTPUTS,    //!< Output enables
+  SI5351_STATS_COMMIT,     //!< commit()
+  SI5351_STATS_QUEUE,      //!< Asynchronous writes sent by poll()/flush()
+  SI5351_STATS_SYNC,       //!< syncFromDevice(), snapshot(), verify()
+  SI5351_STATS_LOCK,       //!< Lock status, waitForLock(), INTR service
+  SI5351_STATS_API_COUNT
+} si5351StatsApi_t;
+
+/*!
+ * @brief Bus traffic counters
+ */
+typedef struct {
+  uint32_t transactions; //!< I2C transactions issued
+  uint32_t reads;        //!< Transactions that read (with a repeated start)
+  uint32_t bytesWritten; //!< Bytes written, register addresses included
+  uint32_t bytesRead;    //!< Bytes read
+  uint32_t errors;       //!< Transactions that failed (ERROR_I2C_TRANSACTION)
+} si5351BusStats_t;
+
+/*!
+ * @brief micros() latency of a register access, average = total_us / count
+ */
+typedef struct {
+  uint32_t count;    //!< Number of calls
+  uint32_t min_us;   //!< Fastest call
+  uint32_t max_us;   //!< Slowest call
+  uint64_t total_us; //!< Sum over all calls
+} si5351Latency_t;
+
+/*!
+ * @brief Everything counted with SI5351_ENABLE_STATS
+ */
+typedef struct {
+  si5351BusStats_t total;                       //!< All traffic
+  si5351BusStats_t api[SI5351_STATS_API_COUNT]; //!< Traffic per API
+  si5351Latency_t write8;                       //!< Single register writes
+  si5351Latency_t writeN;                       //!< Register burst writes
+  si5351Latency_t read8;                        //!< Single register reads
+  si5351Latency_t lock[2]; //!< PLL A/B reset to lock seen in register 0
+} si5351Stats_t;
+#endif
+
+/*!
+ * @brief One register burst waiting in the asynchronous write queue
+ */
+typedef struct {
+  uint8_t reg;   //!< First register of the burst
+  uint8_t len;   //!< Number of registers
+  uint8_t value; //!< Value for ordered single-register writes (3 and 177)
+} si5351QueuedWrite_t;
+
+/*!
+ * @brief The newest state requested for an output or PLL, waiting for
+ *        poll() (see requestFrequency())
+ */
+typedef struct {
+  uint64_t freq_milliHz; //!< Output frequency, or 0 for a divider
+  uint32_t num;          //!< Divider numerator b of a + b / c
+  uint32_t denom;        //!< Divider denominator c
+  uint16_t div;          //!< Divider integer part a
+  si5351PLL_t pll;       //!< PLL to feed the output from, or to program
+} si5351Request_t;
+
+/*!
+ * @brief Called by poll() when the write queue empties or a burst fails
+ */
+typedef void (*si5351WriteCallback_t)(err_t status);
+
+/*!
+ * @brief Called by poll() after the INTR pin fired, with register 0
+ */
+typedef void (*si5351StatusCallback_t)(uint8_t status);
+
 /*!
  * @brief SI5351 constructor
  */
 typedef struct {
-  bool initialised;                //!< Initialization status of SI5351
+  /* Widest fields first, so the flags pack together at the end */
   si5351CrystalFreq_t crystalFreq; //!< Crystal frequency
-  si5351CrystalLoad_t crystalLoad; //!< Crystal load capacitors
   uint32_t crystalPPM;             //!< Frequency synthesis
+  uint32_t plla_freq;              //!< PLL A frequency, in Hz (rounded)
+  uint32_t pllb_freq;              //!< PLL B frequency, in Hz (rounded)
+  int32_t crystalPPB;              //!< Crystal calibration, in ppb
+  si5351CrystalLoad_t crystalLoad; //!< Crystal load capacitors
+  bool initialised;                //!< Initialization status of SI5351
   bool plla_configured;            //!< Phase-locked loop A configured
-  uint32_t plla_freq;              //!< Phase-locked loop A frequency
   bool pllb_configured;            //!< Phase-locked loop B configured
-  uint32_t pllb_freq;              //!< Phase-locked loop B frequency
 } si5351Config_t;
 
 /*!
@@ -273,33 +454,402 @@ class Adafruit_SI5351 {
 public:
   Adafruit_SI5351(void); //!< SI5351 object
 
-  err_t begin(TwoWire *theWire = &Wire); //!< @return ERROR_NONE
-  err_t setClockBuilderData(void);       //!< @return ERROR_NONE
+  err_t begin(TwoWire *theWire = &Wire, uint8_t addr = SI5351_ADDRESS,
+              const uint8_t *plan = NULL,
+              bool *warm = NULL);            //!< @return ERROR_NONE
+  err_t setClockBuilderData(void);           //!< @return ERROR_NONE
+  err_t loadRegisterMap(const uint8_t *map); //!< @return ERROR_NONE
+  err_t loadRegisterFile(Stream *file);      //!< @return ERROR_NONE
+  err_t savePlan(uint8_t *blob, uint16_t size, uint16_t *len);
+  err_t restorePlan(const uint8_t *blob, uint16_t len);
   err_t setupPLL(si5351PLL_t pll, uint8_t mult, uint32_t num,
                  uint32_t denom);                   //!< @return ERROR_NONE
   err_t setupPLLInt(si5351PLL_t pll, uint8_t mult); //!< @return ERROR_NONE
+  err_t resetPLL(si5351PLL_t pll);                  //!< @return ERROR_NONE
+  void enableFastRetune(bool enabled);
+  err_t fineTunePLL(si5351PLL_t pll, int32_t ppb);
+  void setCrystalCalibration(int32_t ppb);
+  err_t getDeviceStatus(uint8_t *status); //!< @return ERROR_NONE
+  err_t waitForLock(si5351PLL_t pll, uint32_t timeout_ms);
+  err_t enableLockInterrupt(int8_t pin,
+                            si5351StatusCallback_t callback = NULL);
   err_t setupMultisynth(uint8_t output, si5351PLL_t pllSource, uint32_t div,
                         uint32_t num, uint32_t denom); //!< @return ERROR_NONE
   err_t setupMultisynthInt(uint8_t output, si5351PLL_t pllSource,
                            si5351MultisynthDiv_t div); //!< @return ERROR_NONE
+  err_t setFrequency(uint8_t output, uint64_t freq_milliHz,
+                     si5351PLL_t pllSource = SI5351_PLL_A,
+                     int64_t *error_milliHz = NULL); //!< @return ERROR_NONE
+  err_t planFrequencies(const si5351OutputRequest_t *requests,
+                        si5351FrequencyPlan_t *plan);
+  err_t setFrequencies(const si5351FrequencyPlan_t *plan);
+  err_t getPLLFrequency(si5351PLL_t pll, uint64_t *freq_milliHz);
+  err_t getOutputFrequency(uint8_t output, uint64_t *freq_milliHz);
+
+  err_t buildToneTable(si5351ToneTable_t *table, si5351Tone_t *tones,
+                       uint8_t count, uint8_t output,
+                       const uint64_t *freqs_milliHz,
+                       si5351ToneMode_t mode = SI5351_TONE_MULTISYNTH);
+  err_t selectTone(const si5351ToneTable_t *table, uint8_t tone);
+
+  err_t startSweep(uint8_t output, uint64_t start_milliHz,
+                   uint64_t stop_milliHz, uint16_t steps, uint32_t dwell_us,
+                   si5351SweepCallback_t callback = NULL,
+                   si5351PLL_t pllSource = SI5351_PLL_A);
+  err_t sweepStep(void);
+  void stopSweep(void);
+  /*!
+   * @return True while a sweep started with startSweep() is running
+   */
+  bool isSweeping(void) { return m_sweep.active; }
+
+  err_t setPhaseOffsets(si5351PLL_t pll, const uint16_t *phase_centiDeg);
 
   err_t enableSpreadSpectrum(bool enabled);
+  err_t setupSpreadSpectrum(uint16_t spread_centiPercent,
+                            si5351SpreadMode_t mode = SI5351_SPREAD_DOWN);
   err_t enableOutputs(bool enabled);
+  err_t setOutputEnableMask(uint8_t mask); //!< @return ERROR_NONE
+  err_t enableOutput(uint8_t output, bool enabled);
+  err_t setOutputPower(uint8_t output, bool poweredUp);
+  err_t setOutputDrive(uint8_t output, si5351Drive_t drive);
+  err_t setOutputInvert(uint8_t output, bool inverted);
+  err_t setOutputDisableState(uint8_t output, si5351DisableState_t state);
+  err_t setOutputConfig(uint8_t mask, const si5351OutputConfig_t *config);
+  err_t getOutputConfig(uint8_t output, si5351OutputConfig_t *config);
   /*!
    * @param output Enables or disables output
    * @param div Set of output divider values (2^n, n=1..7)
    */
   err_t setupRdiv(uint8_t output, si5351RDiv_t div); //!< @return ERROR_NONE
 
+  err_t beginTransaction(bool disableOutputs = true);
+  err_t commit(void);
+
+  err_t enableAsyncWrites(bool enabled,
+                          si5351WriteCallback_t callback = NULL);
+  err_t poll(void);
+  err_t flush(void);
+  /*!
+   * @return Number of register bursts still waiting to go out
+   */
+  uint8_t pendingWrites(void) { return m_queueCount; }
+
+  err_t requestFrequency(uint8_t output, uint64_t freq_milliHz,
+                         si5351PLL_t pllSource = SI5351_PLL_A);
+  err_t requestMultisynth(uint8_t output, si5351PLL_t pllSource, uint32_t div,
+                          uint32_t num, uint32_t denom);
+  err_t requestPLL(si5351PLL_t pll, uint8_t mult, uint32_t num,
+                   uint32_t denom);
+  /*!
+   * @return Requests still waiting for poll(): bits 0..7 for CLK0..CLK7,
+   *         bits 8 and 9 for PLL A and B
+   */
+  uint16_t pendingRequests(void) { return m_requestPending; }
+
+  err_t syncFromDevice(void);     //!< @return ERROR_NONE
+  err_t snapshot(uint8_t *image); //!< @return ERROR_NONE
+  err_t verify(const uint8_t *plan = NULL, uint8_t *mismatch = NULL);
+  void setRegisterVolatile(uint8_t reg, bool isVolatile);
+
+  static void encodeDivider(uint32_t a, uint32_t b, uint32_t c, uint8_t *regs);
+  static uint8_t decodeRegisterImage(const uint8_t *image, uint32_t xtal_Hz,
+                                     si5351RegisterImage_t *decoded);
+  static void packDivider(uint32_t P1, uint32_t P2, uint32_t P3,
+                          uint8_t *regs);
+  static void decodeDivider(const uint8_t *regs, uint32_t *P1, uint32_t *P2,
+                            uint32_t *P3);
+
+#ifdef SI5351_ENABLE_STATS
+  /*!
+   * @return Number of I2C transactions issued since startup or reset
+   */
+  uint32_t getTransactionCount(void) { return m_stats.total.transactions; }
+  /*!
+   * @brief Clears the I2C transaction counter (and all other stats)
+   */
+  void resetTransactionCount(void) { resetStats(); }
+  /*!
+   * @return Bus traffic and latency counters since startup or resetStats()
+   */
+  const si5351Stats_t *getStats(void) { return &m_stats; }
+  void resetStats(void);
+  static uint32_t busMicros(const si5351BusStats_t *stats, uint32_t busHz);
+#endif
+
 private:
+  friend class Adafruit_SI5351_Group;
+
   si5351Config_t m_si5351Config;
 
-  Adafruit_I2CDevice *i2c_dev = NULL; ///< Pointer to I2C bus interface
+  bool m_fastRetune;       ///< Skip the PLL reset for small setupPLL() steps
+  uint64_t m_fineBaseX[2]; ///< PLL A/B dividers fineTunePLL() works from
+  uint64_t m_fineX[2];     ///< PLL A/B dividers fineTunePLL() last wrote
+  si5351Sweep_t m_sweep;   ///< Frequency sweep in progress
+  bool m_inTransaction;    ///< Writes are staged until commit()
+  bool m_txDisableOutputs; ///< commit() disables outputs while it works
+  uint8_t m_pendingReset;  ///< PLL reset bits staged for commit()
+  bool m_txWriteOE;        ///< commitOutputs() has an enable mask to write
+  uint8_t m_txOE;          ///< Output enable mask commitOutputs() writes
+  err_t commitParameters(void);
+  err_t commitResets(void);
+  err_t commitOutputs(void);
+  err_t abortCommit(err_t err);
+
+  Adafruit_I2CDevice m_i2cDevice;     ///< I2C bus interface, no heap needed
+  Adafruit_I2CDevice *i2c_dev = NULL; ///< &m_i2cDevice once begin() ran
   err_t write8(uint8_t reg, uint8_t value);
   err_t read8(uint8_t reg, uint8_t *value);
+  err_t readN(uint8_t reg, uint8_t *values, uint8_t len);
+  err_t readRanges(void);
+  err_t verifyRun(uint8_t reg, uint8_t len, const uint8_t *values,
+                  uint8_t *mismatch);
   err_t writeN(uint8_t *data, uint8_t n);
+  err_t writeBurst(uint8_t reg, const uint8_t *values, uint8_t len);
+  err_t writeBurstDelta(uint8_t reg, const uint8_t *values, uint8_t len);
+  err_t sendBurst(uint8_t reg, const uint8_t *values, uint8_t len);
+  err_t stageBurst(uint8_t reg, const uint8_t *values, uint8_t len);
+  err_t issueBurst(uint8_t reg, const uint8_t *values, uint8_t len);
+  err_t updateControl(uint8_t mask, uint8_t clear, uint8_t set);
+  err_t updateDisableState(uint8_t mask, si5351DisableState_t state);
+  err_t updateMaskBits(uint8_t reg, uint8_t mask, bool set);
+
+  /* Asynchronous write queue, drained by poll() */
+  bool m_async;                          ///< Writes are queued instead of sent
+  si5351WriteCallback_t m_writeCallback; ///< Queue status callback
+  si5351QueuedWrite_t m_queue[SI5351_QUEUE_DEPTH]; ///< Ring of bursts
+  int8_t m_intPin;                         ///< INTR pin, or -1 if unused
+  si5351StatusCallback_t m_statusCallback; ///< INTR status callback
+  uint8_t m_queueHead;                     ///< Oldest queued burst
+  uint8_t m_queueCount;                    ///< Number of queued bursts
+  err_t queueBurst(uint8_t reg, const uint8_t *values, uint8_t len);
+
+  /* Latest-wins requests, applied by poll() */
+  si5351Request_t m_requests[10]; ///< CLK0..CLK7, then PLL A/B
+  uint16_t m_requestPending;      ///< Bit per m_requests entry
+  err_t applyRequests(void);
+  err_t serviceInterrupt(void);
+  err_t sendQueued(void);
+  bool isQueued(uint8_t reg);
+  static bool isOrderedWrite(uint8_t reg, uint8_t len);
+
+  /* Shadow copy of the register map, kept in step with every write */
+  uint8_t m_regCache[SI5351_REGISTER_CACHE_SIZE]; ///< Last known values
+  uint8_t m_regValid[(SI5351_REGISTER_CACHE_SIZE + 7) / 8];    ///< Cached bits
+  uint8_t m_regVolatile[(SI5351_REGISTER_CACHE_SIZE + 7) / 8]; ///< Never cached
+  uint8_t m_regDirty[(SI5351_REGISTER_CACHE_SIZE + 7) / 8];    ///< Staged
+  bool isCached(uint8_t reg);
+  bool isDirty(uint8_t reg);
+  void cacheStore(uint8_t reg, const uint8_t *values, uint8_t len);
+  void invalidateCache(void);
+  void invalidateCache(uint8_t reg, uint8_t len);
+  err_t readCached(uint8_t reg, uint8_t *value);
+
+  bool planMatches(const uint8_t *map);
+  static uint16_t crc16(const uint8_t *data, uint16_t len);
+  static bool parseRegisterField(const char *text, uint16_t *number);
+  void sweepRegisters(uint8_t *regs);
+  static uint8_t rdivRegister(uint8_t output, uint8_t *shift);
+  uint64_t crystalMilliHz(void);
+  bool getPLLRatio(si5351PLL_t pll, uint64_t *M, uint32_t *c);
+  bool vcoMicroHz(si5351PLL_t pll, uint64_t *vco_microHz);
+  void recordPLL(si5351PLL_t pll);
+  bool solveMultisynth(si5351PLL_t pll, uint64_t freq_milliHz,
+                       uint32_t fixedDenom, uint32_t *a, uint32_t *b,
+                       uint32_t *c, uint8_t *rdiv);
+  bool solveDivider(uint64_t vcoNum, uint32_t vcoDen, uint64_t freq_milliHz,
+                    uint32_t fixedDenom, uint32_t *a, uint32_t *b,
+                    uint32_t *c, uint8_t *rdiv);
+  static bool planInteger(uint64_t vco_milliHz,
+                          const si5351OutputRequest_t *request,
+                          uint8_t output, uint32_t *div, uint8_t *rdiv);
+  bool planBuild(const uint64_t *vco_milliHz, const uint8_t *intMask,
+                 const uint8_t *fracMask, const si5351OutputRequest_t *requests,
+                 si5351FrequencyPlan_t *plan);
+  static uint64_t gcd(uint64_t x, uint64_t y);
+  bool solvePLL(uint64_t vco_milliHz, uint32_t fixedDenom, uint32_t *mult,
+                uint32_t *num, uint32_t *denom);
+  static void fitFraction(uint64_t num, uint64_t den, uint32_t fixedDenom,
+                          uint32_t *b, uint32_t *c);
+  static void bestRational(uint64_t num, uint64_t den, uint32_t *b,
+                           uint32_t *c);
+  static uint64_t mulDiv(uint64_t x, uint32_t m, uint32_t d);
+  static uint64_t mulDivLong(uint64_t x, uint32_t m, uint64_t d);
+  static void spreadStep(uint64_t num, uint64_t den, uint16_t *P1,
+                         uint16_t *P2);
+
+#ifdef SI5351_ENABLE_STATS
+  /* Charges bus traffic to the outermost public API for its lifetime */
+  struct StatsScope {
+    StatsScope(Adafruit_SI5351 *dev, si5351StatsApi_t api)
+        : dev(dev), prev(dev->m_statsApi) {
+      if (prev == SI5351_STATS_OTHER)
+        dev->m_statsApi = api;
+    }
+    ~StatsScope() { dev->m_statsApi = prev; }
+    Adafruit_SI5351 *dev;  ///< Device being counted
+    si5351StatsApi_t prev; ///< API to restore on exit
+  };
+  si5351Stats_t m_stats;       ///< Counters
+  si5351StatsApi_t m_statsApi; ///< API the current traffic belongs to
+  uint32_t m_resetMicros[2];   ///< micros() of the last PLL A/B reset
+  uint8_t m_lockPending;       ///< Reset PLLs not yet seen locked (LOL bits)
+  void countTransaction(uint8_t written, uint8_t read, bool ok);
+  void noteResets(uint8_t value);
+  void noteLockStatus(uint8_t status);
+  static void recordLatency(si5351Latency_t *lat, uint32_t start_us);
+#endif
+};
+
+/*!
+ * @brief Several SI5351s, on one bus or several, retuned together
+ */
+class Adafruit_SI5351_Group {
+public:
+  Adafruit_SI5351_Group(void);
+
+  err_t add(Adafruit_SI5351 *device); //!< @return ERROR_NONE
+  err_t beginTransaction(bool disableOutputs = true);
+  err_t commit(void);
+
+private:
+  Adafruit_SI5351 *m_devices[SI5351_GROUP_SIZE]; ///< Members, in add() order
+  uint8_t m_count;                               ///< Number of members
+};
+
+/* Compile-time register maps, for boards whose plan is fixed at build time.
+ * The SI5351_MAP_* macros expand to runs for loadRegisterMap(), with every
+ * divider checked by static_assert and encoded by the compiler: the image
+ * sits in flash and the run-time only streams it out, no solver or encoder
+ * is called.
+ *
+ *   static const uint8_t plan[] PROGMEM = {
+ *       3, 1, 0xFF, // Outputs off
+ *       SI5351_MAP_PLL(SI5351_PLL_A, 25000000, 36, 0, 1),
+ *       SI5351_MAP_MULTISYNTH(0, 36, 0, 1, SI5351_R_DIV_1),
+ *       16, 1, SI5351_CLK_CONTROL(SI5351_PLL_A, 0, SI5351_DRIVE_8MA),
+ *       SI5351_MAP_RESET,
+ *       3, 1, 0xFE, // CLK0 on
+ *       SI5351_MAP_END};
+ *   clockgen.loadRegisterMap(plan); // 25MHz * 36 / 36 = 25MHz on CLK0
+ */
+#if (__cplusplus >= 201103L) || defined(DOXYGEN)
+/*!
+ * @brief Compile-time P1/P2/P3 encoding of a divider a + b / c, the same
+ *        as encodeDivider() at run time
+ */
+template <uint32_t A, uint32_t B, uint32_t C> struct si5351DividerImage {
+  static constexpr uint32_t F = C ? 128 * B / C : 0; //!< floor(128 * b / c)
+  static constexpr uint32_t P1 = 128 * A + F - 512;  //!< 18-bit P1
+  static constexpr uint32_t P2 = 128 * B - C * F;    //!< 20-bit P2
+  static constexpr uint32_t P3 = C;                  //!< 20-bit P3
+  /*!
+   * @return Register byte i (0..7), with extra (R divider, MSx_DIVBY4)
+   *         in byte 2
+   */
+  static constexpr uint8_t byte(uint8_t i, uint8_t extra = 0) {
+    return (i == 0)   ? (P3 >> 8) & 0xFF
+           : (i == 1) ? P3 & 0xFF
+           : (i == 2) ? ((P1 >> 16) & 0x03) | extra
+           : (i == 3) ? (P1 >> 8) & 0xFF
+           : (i == 4) ? P1 & 0xFF
+           : (i == 5) ? ((P3 >> 12) & 0xF0) | ((P2 >> 16) & 0x0F)
+           : (i == 6) ? (P2 >> 8) & 0xFF
+                      : P2 & 0xFF;
+  }
+};
 
-  uint8_t lastRdivValue[3];
+/*!
+ * @brief A PLL feedback divider a + b / c, checked at compile time
+ */
+template <uint32_t XTAL, uint32_t A, uint32_t B, uint32_t C>
+struct si5351PLLImage : si5351DividerImage<A, B, C> {
+  static_assert((C >= 1) && (C <= SI5351_FRAC_MAX),
+                "PLL denominator must be 1..1048575");
+  static_assert(B < C, "PLL numerator must be below the denominator");
+  static_assert((A >= 15) && ((uint64_t)A * C + B <= 90ULL * C),
+                "PLL multiplier must be 15..90");
+  static_assert((uint64_t)XTAL * ((uint64_t)A * C + B) >=
+                    (uint64_t)SI5351_VCO_MIN_HZ * C,
+                "VCO below 600MHz");
+  static_assert((uint64_t)XTAL * ((uint64_t)A * C + B) <=
+                    (uint64_t)SI5351_VCO_MAX_HZ * C,
+                "VCO above 900MHz");
+};
+
+/*!
+ * @brief An output multisynth (CLK0..CLK5) a + b / c and R divider,
+ *        checked at compile time
+ */
+template <uint8_t OUT, uint32_t A, uint32_t B, uint32_t C, uint8_t R>
+struct si5351MultisynthImage : si5351DividerImage<A, B, C> {
+  static_assert(OUT < 6, "CLK6/CLK7 take SI5351_MAP_MULTISYNTH67()");
+  static_assert((C >= 1) && (C <= SI5351_FRAC_MAX),
+                "Multisynth denominator must be 1..1048575");
+  static_assert(B < C, "Multisynth numerator must be below the denominator");
+  static_assert((((A == 4) || (A == 6)) && (B == 0)) ||
+                    ((A >= 8) && ((uint64_t)A * C + B <= 2048ULL * C)),
+                "Multisynth divider must be 4, 6 or 8..2048");
+  static_assert(R <= 7, "R divider must be SI5351_R_DIV_1..128");
+  static constexpr uint8_t extra =
+      (R << 4) | ((A == 4) ? 0x0C : 0); //!< Rx_DIV and MSx_DIVBY4
 };
 
+/*!
+ * @brief The CLK6/CLK7 integer multisynths and their R dividers
+ *        (registers 90..92), checked at compile time
+ */
+template <uint32_t A6, uint32_t A7, uint8_t R6, uint8_t R7>
+struct si5351Multisynth67Image {
+  static_assert((A6 == 0) || ((A6 >= 6) && (A6 <= 254) && !(A6 & 1)),
+                "MS6 must be an even integer 6..254, or 0 if unused");
+  static_assert((A7 == 0) || ((A7 >= 6) && (A7 <= 254) && !(A7 & 1)),
+                "MS7 must be an even integer 6..254, or 0 if unused");
+  static_assert((R6 <= 7) && (R7 <= 7),
+                "R divider must be SI5351_R_DIV_1..128");
+  static constexpr uint8_t rdiv = (R7 << 4) | R6; //!< Register 92
+};
+#endif
+
+/*! A run for PLL A or B (registers 26..33 or 34..41):
+ *  fVCO = xtal * (a + b / c) */
+#define SI5351_MAP_PLL(pll, xtal, a, b, c)                                     \
+  ((pll) == SI5351_PLL_B ? 34 : 26), 8,                                        \
+      si5351PLLImage<xtal, a, b, c>::byte(0),                                  \
+      si5351PLLImage<xtal, a, b, c>::byte(1),                                  \
+      si5351PLLImage<xtal, a, b, c>::byte(2),                                  \
+      si5351PLLImage<xtal, a, b, c>::byte(3),                                  \
+      si5351PLLImage<xtal, a, b, c>::byte(4),                                  \
+      si5351PLLImage<xtal, a, b, c>::byte(5),                                  \
+      si5351PLLImage<xtal, a, b, c>::byte(6),                                  \
+      si5351PLLImage<xtal, a, b, c>::byte(7)
+
+/*! A run for multisynth 0..5 (registers 42 + 8 * output ..): divider
+ *  a + b / c, R divider and, for a divider of 4, MSx_DIVBY4 */
+#define SI5351_MAP_MULTISYNTH(output, a, b, c, rdiv)                           \
+  (42 + 8 * (output)), 8,                                                      \
+      si5351MultisynthImage<output, a, b, c, rdiv>::byte(0),                   \
+      si5351MultisynthImage<output, a, b, c, rdiv>::byte(1),                   \
+      si5351MultisynthImage<output, a, b, c, rdiv>::byte(                      \
+          2, si5351MultisynthImage<output, a, b, c, rdiv>::extra),             \
+      si5351MultisynthImage<output, a, b, c, rdiv>::byte(3),                   \
+      si5351MultisynthImage<output, a, b, c, rdiv>::byte(4),                   \
+      si5351MultisynthImage<output, a, b, c, rdiv>::byte(5),                   \
+      si5351MultisynthImage<output, a, b, c, rdiv>::byte(6),                   \
+      si5351MultisynthImage<output, a, b, c, rdiv>::byte(7)
+
+/*! A run for MS6/MS7 and their shared R divider register (90..92) */
+#define SI5351_MAP_MULTISYNTH67(a6, a7, rdiv6, rdiv7)                          \
+  90, 3, (a6), (a7), si5351Multisynth67Image<a6, a7, rdiv6, rdiv7>::rdiv
+
+/*! A CLKx control value (registers 16..23): powered up, fed from its own
+ *  multisynth on pll, MSx_INT set when the multisynth num is 0 (on CLK6/7
+ *  that bit is FBx_INT: pass the PLL's num instead) */
+#define SI5351_CLK_CONTROL(pll, num, drive)                                    \
+  (0x0C | ((pll) == SI5351_PLL_B ? 0x20 : 0) | ((num) == 0 ? 0x40 : 0) |       \
+   ((drive)&0x03))
+
+/*! A run that resets both PLLs, to follow their new settings */
+#define SI5351_MAP_RESET 177, 1, 0xA0
+
 #endif
@@ -0,0 +1,168 @@
+/* Measures what the main driver calls cost, as a baseline for performance
+   work. For each call it prints the measured time per call and the CPU
+   time spent in the driver's own math (measured with async writes on, so
+   no bus traffic is waited for).
+
+   Build with SI5351_ENABLE_STATS defined for every file (e.g.
+   build_flags = -DSI5351_ENABLE_STATS in PlatformIO, or
+   --build-property compiler.cpp.extra_flags=-DSI5351_ENABLE_STATS with
+   arduino-cli) to also get transactions, bytes and the modelled bus time
+   at 100kHz, 400kHz and 1MHz per call.
+
+   extras/test/benchmark.cpp runs the same calls on a desktop, against a
+   mock I2C device (make -C extras/test bench). */
+
+#include <Adafruit_SI5351.h>
+
+Adafruit_SI5351 clockgen = Adafruit_SI5351();
+
+#define RUNS 20
+
+/* One call under test, i is the run number */
+typedef err_t (*benchFunc_t)(uint16_t i);
+
+err_t benchBegin(uint16_t)
+{
+  return clockgen.begin();
+}
+
+err_t benchClockBuilder(uint16_t)
+{
+  return clockgen.setClockBuilderData();
+}
+
+err_t benchPLLInt(uint16_t i)
+{
+  return clockgen.setupPLLInt(SI5351_PLL_A, (i & 1) ? 35 : 36);
+}
+
+err_t benchPLLFrac(uint16_t i)
+{
+  return clockgen.setupPLL(SI5351_PLL_B, 24, 2 + i, 3 + 2 * i);
+}
+
+err_t benchMultisynth(uint16_t i)
+{
+  return clockgen.setupMultisynth(1, SI5351_PLL_B, 45, 1 + i, 2 + 2 * i);
+}
+
+err_t benchRdiv(uint16_t i)
+{
+  return clockgen.setupRdiv(2, (i & 1) ? SI5351_R_DIV_32 : SI5351_R_DIV_64);
+}
+
+err_t benchFrequency(uint16_t i)
+{
+  /* Small hops keep the VCO: only the multisynth is solved */
+  return clockgen.setFrequency(0, 14074000000ULL + 1000000ULL * i);
+}
+
+err_t benchFrequencyVCO(uint16_t i)
+{
+  /* CLK6 is integer only: the VCO is solved and the PLL reset */
+  return clockgen.setFrequency(6, 7000000000ULL + 123456789ULL * i,
+                               SI5351_PLL_B);
+}
+
+/**************************************************************************/
+/*
+    Runs one call RUNS times and prints its costs
+*/
+/**************************************************************************/
+void bench(const char *name, benchFunc_t func)
+{
+  uint32_t start, wall = 0, cpu = 0;
+
+  /* Wall clock time, bus included */
+#ifdef SI5351_ENABLE_STATS
+  clockgen.resetStats();
+#endif
+  for (uint16_t i = 0; i < RUNS; i++)
+  {
+    start = micros();
+    func(i);
+    wall += micros() - start;
+  }
+#ifdef SI5351_ENABLE_STATS
+  si5351BusStats_t total = clockgen.getStats()->total;
+#endif
+
+  /* CPU time only: queue the writes, time the call, then send them */
+  for (uint16_t i = 0; i < RUNS; i++)
+  {
+    clockgen.enableAsyncWrites(true);
+    start = micros();
+    func(i);
+    cpu += micros() - start;
+    clockgen.enableAsyncWrites(false);
+  }
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print((float)wall / RUNS, 1);
+  Serial.print(" us/call, ");
+  Serial.print((float)cpu / RUNS, 1);
+  Serial.print(" us CPU");
+#ifdef SI5351_ENABLE_STATS
+  Serial.print(", ");
+  Serial.print((float)total.transactions / RUNS, 1);
+  Serial.print(" transactions, ");
+  Serial.print((float)(total.bytesWritten + total.bytesRead) / RUNS, 1);
+  Serial.print(" bytes, bus ");
+  Serial.print((float)Adafruit_SI5351::busMicros(&total, 100000) / RUNS, 0);
+  Serial.print("/");
+  Serial.print((float)Adafruit_SI5351::busMicros(&total, 400000) / RUNS, 0);
+  Serial.print("/");
+  Serial.print((float)Adafruit_SI5351::busMicros(&total, 1000000) / RUNS, 0);
+  Serial.print(" us @ 100k/400k/1M");
+#endif
+  Serial.println("");
+}
+
+/**************************************************************************/
+/*
+    Arduino setup function (automatically called at startup)
+*/
+/**************************************************************************/
+void setup(void)
+{
+  Serial.begin(115200);
+  while (!Serial) delay(10);
+  Serial.println("Si5351 Benchmark"); Serial.println("");
+
+  /* Initialise the sensor */
+  if (clockgen.begin() != ERROR_NONE)
+  {
+    /* There was a problem detecting the IC ... check your connections */
+    Serial.print("Ooops, no Si5351 detected ... Check your wiring or I2C ADDR!");
+    while(1);
+  }
+
+  bench("begin()", benchBegin);
+  bench("setClockBuilderData()", benchClockBuilder);
+
+  /* Outputs need their PLL before the multisynth calls */
+  clockgen.setupPLLInt(SI5351_PLL_A, 36);
+  clockgen.setupPLL(SI5351_PLL_B, 24, 2, 3);
+  clockgen.setupMultisynth(2, SI5351_PLL_B, 900, 0, 1);
+  clockgen.enableOutputs(true);
+
+  bench("setupPLLInt()", benchPLLInt);
+  bench("setupPLL() fractional", benchPLLFrac);
+  bench("setupMultisynth()", benchMultisynth);
+  bench("setupRdiv()", benchRdiv);
+  bench("setFrequency() same VCO", benchFrequency);
+  bench("setFrequency() new VCO", benchFrequencyVCO);
+
+  Serial.println("Done");
+}
+
+/**************************************************************************/
+/*
+    Arduino loop function, called once 'setup' is complete (your own code
+    should go here)
+*/
+/**************************************************************************/
+void loop(void)
+{
+}
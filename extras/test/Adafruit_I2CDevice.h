@@ -0,0 +1,59 @@
+/*
+ * @file Adafruit_I2CDevice.h
+ *
+ * Host stand-in for Adafruit BusIO's Adafruit_I2CDevice. The device is a
+ * plain register file (mockRegs), every transaction is recorded in
+ * mockLog, and mockBusMicros() models how long the recorded traffic takes
+ * on a real bus.
+ */
+
+#ifndef _MOCK_I2CDEVICE_H_
+#define _MOCK_I2CDEVICE_H_
+
+#include <Wire.h>
+#include <vector>
+
+#define MOCK_BUFFER_SIZE 32 //!< Default maxBufferSize(), as on most cores
+
+/*!
+ * @brief One recorded bus transaction
+ */
+typedef struct {
+  uint8_t address; //!< 7-bit device address
+  bool read;       //!< write_then_read() rather than write()
+  uint8_t reg;     //!< First register
+  uint8_t len;     //!< Registers written or read
+} MockTransaction;
+
+extern uint8_t mockRegs[256];                //!< The device registers
+extern std::vector<MockTransaction> mockLog; //!< Every transaction so far
+
+extern size_t mockBufferSize;  //!< maxBufferSize() result
+extern uint32_t mockFailAfter; //!< Fail the Nth write from now, 0 never
+
+void mockReset(void);
+uint32_t mockBytes(void);
+uint32_t mockBusMicros(uint32_t busHz);
+
+/*!
+ * @brief The subset of Adafruit_I2CDevice the driver uses, on mockRegs
+ */
+class Adafruit_I2CDevice {
+public:
+  Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire = &Wire)
+      : _addr(addr), _wire(theWire) {}
+  uint8_t address(void) { return _addr; }
+  bool begin(bool /* addr_detect */ = true) { return true; }
+  size_t maxBufferSize() { return mockBufferSize; }
+  bool write(const uint8_t *buffer, size_t len, bool stop = true,
+             const uint8_t *prefix_buffer = NULL, size_t prefix_len = 0);
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len,
+                       bool stop = false);
+
+private:
+  uint8_t _addr;
+  TwoWire *_wire;
+};
+
+#endif
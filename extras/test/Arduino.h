@@ -0,0 +1,45 @@
+/*
+ * @file Arduino.h
+ *
+ * Host stand-in for the parts of the Arduino core the driver uses, so that
+ * Adafruit_SI5351.cpp builds on a desktop. Time is simulated: micros()
+ * moves on by 10us per call and delay() by the time asked for, so lock
+ * and dwell loops finish at once.
+ */
+
+#ifndef _MOCK_ARDUINO_H_
+#define _MOCK_ARDUINO_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FALLING 2                        //!< attachInterrupt() mode
+#define digitalPinToInterrupt(pin) (pin) //!< Pins are their own interrupt
+
+typedef bool boolean; //!< Arduino's name for bool
+
+unsigned long micros(void);
+unsigned long millis(void);
+void delay(unsigned long ms);
+void yield(void);
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+void noInterrupts(void);
+void interrupts(void);
+
+/*!
+ * @brief The part of Arduino's Stream that loadRegisterFile() reads from
+ */
+class Stream {
+public:
+  virtual ~Stream() {}
+  virtual int available() = 0; //!< @return Bytes left to read
+  virtual int read() = 0;      //!< @return Next byte, or -1 at the end
+  virtual int peek() = 0;      //!< @return Next byte without taking it
+  size_t readBytes(char *buffer, size_t length);
+};
+
+#endif
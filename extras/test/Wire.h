@@ -0,0 +1,20 @@
+/*
+ * @file Wire.h
+ *
+ * Host stand-in for the Arduino Wire library: only the type is needed, the
+ * bus itself is modelled by the mock Adafruit_I2CDevice.
+ */
+
+#ifndef _MOCK_WIRE_H_
+#define _MOCK_WIRE_H_
+
+#include <Arduino.h>
+
+/*!
+ * @brief Placeholder for the I2C controller
+ */
+class TwoWire {};
+
+extern TwoWire Wire; //!< The default bus
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * @file benchmark.cpp
+ *
+ * Host version of examples/si5351_benchmark: runs the main driver calls
+ * against the mock I2C device and prints, per call, the transactions and
+ * bytes on the bus, their modelled time at 100kHz, 400kHz and 1MHz, and
+ * the host CPU time of the driver's own math (measured with async writes,
+ * so no bus traffic is included).
+ */
+
+#include <chrono>
+
+#include "test.h"
+
+#define RUNS 1000 //!< Calls per benchmark
+
+static Adafruit_SI5351 clockgen;
+
+/* One call under test, i is the run number */
+typedef err_t (*benchFunc_t)(uint16_t i);
+
+static err_t benchBegin(uint16_t) { return clockgen.begin(); }
+
+static err_t benchClockBuilder(uint16_t) {
+  return clockgen.setClockBuilderData();
+}
+
+static err_t benchPLLInt(uint16_t i) {
+  return clockgen.setupPLLInt(SI5351_PLL_A, (i & 1) ? 35 : 36);
+}
+
+static err_t benchPLLFrac(uint16_t i) {
+  return clockgen.setupPLL(SI5351_PLL_B, 24, 2 + i, 3 + 2 * i);
+}
+
+static err_t benchMultisynth(uint16_t i) {
+  return clockgen.setupMultisynth(1, SI5351_PLL_B, 45, 1 + i, 2 + 2 * i);
+}
+
+static err_t benchRdiv(uint16_t i) {
+  return clockgen.setupRdiv(2, (i & 1) ? SI5351_R_DIV_32 : SI5351_R_DIV_64);
+}
+
+static err_t benchFrequency(uint16_t i) {
+  /* Small hops keep the VCO: only the multisynth is solved */
+  return clockgen.setFrequency(0, 14074000000ULL + 1000000ULL * i);
+}
+
+static err_t benchFrequencyVCO(uint16_t i) {
+  /* CLK6 is integer only: the VCO is solved and the PLL reset */
+  return clockgen.setFrequency(6, 7000000000ULL + 123456789ULL * i,
+                               SI5351_PLL_B);
+}
+
+/*
+ * Runs one call RUNS times and prints its costs
+ */
+static void bench(const char *name, benchFunc_t func) {
+  typedef std::chrono::steady_clock clock;
+  uint32_t errors = 0;
+
+  /* Bus traffic */
+  mockLog.clear();
+  for (uint16_t i = 0; i < RUNS; i++)
+    errors += (func(i) != ERROR_NONE);
+  double transactions = (double)mockLog.size() / RUNS;
+  double bytes = (double)mockBytes() / RUNS;
+  double bus100k = (double)mockBusMicros(100000) / RUNS;
+  double bus400k = (double)mockBusMicros(400000) / RUNS;
+  double bus1M = (double)mockBusMicros(1000000) / RUNS;
+
+  /* CPU time only: queue the writes, time the call, then send them */
+  clock::duration cpu = clock::duration::zero();
+  for (uint16_t i = 0; i < RUNS; i++) {
+    clockgen.enableAsyncWrites(true);
+    clock::time_point start = clock::now();
+    func(i);
+    cpu += clock::now() - start;
+    clockgen.enableAsyncWrites(false);
+  }
+  double ns = std::chrono::duration<double, std::nano>(cpu).count() / RUNS;
+
+  printf("%-26s %6.1f %7.1f %8.0f %8.0f %8.0f %9.0f", name, transactions, bytes,
+         bus100k, bus400k, bus1M, ns);
+  if (errors)
+    printf("  (%u errors)", (unsigned)errors);
+  printf("\n");
+}
+
+int main(void) {
+  mockReset();
+  if (clockgen.begin() != ERROR_NONE) {
+    printf("begin() failed\n");
+    return 1;
+  }
+
+  printf("%-26s %6s %7s %8s %8s %8s %9s\n", "per call", "trans", "bytes",
+         "us@100k", "us@400k", "us@1M", "CPU ns");
+  bench("begin()", benchBegin);
+  bench("setClockBuilderData()", benchClockBuilder);
+
+  /* Outputs need their PLL before the multisynth calls */
+  clockgen.setupPLLInt(SI5351_PLL_A, 36);
+  clockgen.setupPLL(SI5351_PLL_B, 24, 2, 3);
+  clockgen.setupMultisynth(2, SI5351_PLL_B, 900, 0, 1);
+  clockgen.enableOutputs(true);
+
+  bench("setupPLLInt()", benchPLLInt);
+  bench("setupPLL() fractional", benchPLLFrac);
+  bench("setupMultisynth()", benchMultisynth);
+  bench("setupRdiv()", benchRdiv);
+  bench("setFrequency() same VCO", benchFrequency);
+  bench("setFrequency() new VCO", benchFrequencyVCO);
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * @file mock.cpp
+ *
+ * The host stand-ins declared in Arduino.h, Wire.h and Adafruit_I2CDevice.h
+ */
+
+#include <Adafruit_I2CDevice.h>
+
+uint8_t mockRegs[256];
+std::vector<MockTransaction> mockLog;
+size_t mockBufferSize = MOCK_BUFFER_SIZE;
+uint32_t mockFailAfter = 0;
+
+TwoWire Wire;
+
+static unsigned long mockMicros = 0;
+
+unsigned long micros(void) { return mockMicros += 10; }
+unsigned long millis(void) { return micros() / 1000; }
+void delay(unsigned long ms) { mockMicros += ms * 1000; }
+void yield(void) {}
+void attachInterrupt(uint8_t, void (*)(void), int) {}
+void detachInterrupt(uint8_t) {}
+void noInterrupts(void) {}
+void interrupts(void) {}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = read();
+    if (c < 0)
+      break;
+    buffer[n++] = c;
+  }
+  return n;
+}
+
+/*!
+ * @brief Clears the registers, the transaction log and any injected fault
+ */
+void mockReset(void) {
+  memset(mockRegs, 0, sizeof(mockRegs));
+  mockLog.clear();
+  mockBufferSize = MOCK_BUFFER_SIZE;
+  mockFailAfter = 0;
+}
+
+/*!
+ * @return Bytes on the wire for the logged transactions: the device
+ *         address, the register address and the data
+ */
+uint32_t mockBytes(void) {
+  uint32_t bytes = 0;
+  for (size_t i = 0; i < mockLog.size(); i++)
+    bytes += (mockLog[i].read ? 3 : 2) + mockLog[i].len;
+  return bytes;
+}
+
+/*!
+ * @return Modelled time of the logged transactions at busHz, in us. Each
+ *         byte is 9 clocks with its ACK, plus a start and a stop per
+ *         transaction and a repeated start before the read of a
+ *         write_then_read()
+ */
+uint32_t mockBusMicros(uint32_t busHz) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < mockLog.size(); i++) {
+    uint32_t bytes = (mockLog[i].read ? 3 : 2) + mockLog[i].len;
+    bits += 9 * bytes + (mockLog[i].read ? 3 : 2);
+  }
+  return (bits * 1000000 + busHz / 2) / busHz;
+}
+
+bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
+                               const uint8_t *prefix_buffer,
+                               size_t prefix_len) {
+  if ((len + prefix_len > mockBufferSize) || (prefix_len != 1) || !stop)
+    return false;
+  if (mockFailAfter && (--mockFailAfter == 0))
+    return false;
+
+  MockTransaction t = {_addr, false, prefix_buffer[0], (uint8_t)len};
+  for (size_t i = 0; i < len; i++)
+    mockRegs[(uint8_t)(t.reg + i)] = buffer[i];
+  mockLog.push_back(t);
+
+  return true;
+}
+
+bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer,
+                                         size_t write_len, uint8_t *read_buffer,
+                                         size_t read_len, bool /* stop */) {
+  if ((write_len != 1) || (read_len > mockBufferSize))
+    return false;
+
+  MockTransaction t = {_addr, true, write_buffer[0], (uint8_t)read_len};
+  for (size_t i = 0; i < read_len; i++)
+    read_buffer[i] = mockRegs[(uint8_t)(t.reg + i)];
+  mockLog.push_back(t);
+
+  return true;
+}
@@ -0,0 +1,45 @@
+/*
+ * @file test.h
+ *
+ * Minimal checks for the host tests: each test is a program that returns
+ * non-zero if any CHECK() failed.
+ */
+
+#ifndef _SI5351_TEST_H_
+#define _SI5351_TEST_H_
+
+#include <Adafruit_I2CDevice.h>
+#include <Adafruit_SI5351.h>
+
+static int testFailures = 0; //!< CHECK() failures so far
+
+/*!
+ * @brief Reports cond, with its location, if it is false
+ */
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);          \
+      testFailures++;                                                          \
+    }                                                                          \
+  } while (0)
+
+/*!
+ * @return Write transactions in mockLog
+ */
+static inline uint32_t mockWrites(void) {
+  uint32_t n = 0;
+  for (size_t i = 0; i < mockLog.size(); i++)
+    n += !mockLog[i].read;
+  return n;
+}
+
+/*!
+ * @return The exit status for a test program
+ */
+static inline int testResult(const char *name) {
+  printf("%s: %s\n", name, testFailures ? "FAILED" : "ok");
+  return testFailures ? 1 : 0;
+}
+
+#endif
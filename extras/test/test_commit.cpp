@@ -0,0 +1,88 @@
+/*
+ * @file test_commit.cpp
+ *
+ * beginTransaction()/commit(): a batched setup must leave the same
+ * register image as the plain calls in fewer transactions, and a commit
+ * that fails part way must not leave the cache claiming registers the
+ * device never received.
+ */
+
+#include "test.h"
+
+static void setup(Adafruit_SI5351 *clockgen) {
+  clockgen->setupPLLInt(SI5351_PLL_A, 36);
+  clockgen->setupPLL(SI5351_PLL_B, 24, 2, 3);
+  clockgen->setupMultisynth(0, SI5351_PLL_A, 36, 0, 1);
+  clockgen->setupMultisynth(1, SI5351_PLL_B, 45, 1, 2);
+  clockgen->setupMultisynth(2, SI5351_PLL_B, 900, 0, 1);
+  clockgen->setupRdiv(2, SI5351_R_DIV_64);
+  clockgen->enableOutputs(true);
+}
+
+static void testBatching(void) {
+  Adafruit_SI5351 clockgen;
+  uint8_t plain[256];
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+  mockLog.clear();
+  setup(&clockgen);
+  uint32_t plainWrites = mockWrites();
+  memcpy(plain, mockRegs, sizeof(plain));
+  plain[SI5351_REGISTER_177_PLL_RESET] = 0; /* Self-clearing */
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+  mockLog.clear();
+  CHECK(clockgen.beginTransaction() == ERROR_NONE);
+  setup(&clockgen);
+  CHECK(mockLog.empty());
+  CHECK(clockgen.commit() == ERROR_NONE);
+  mockRegs[SI5351_REGISTER_177_PLL_RESET] = 0;
+
+  printf("setup: %u writes plain, %u batched\n", (unsigned)plainWrites,
+         (unsigned)mockWrites());
+  /* Outputs off, three parameter bursts, one PLL reset, outputs on */
+  CHECK(mockWrites() <= 6);
+  CHECK(mockWrites() < plainWrites);
+  CHECK(memcmp(plain, mockRegs, sizeof(plain)) == 0);
+}
+
+static void testFailedCommit(void) {
+  Adafruit_SI5351 clockgen;
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+  setup(&clockgen);
+
+  /* The outputs are blanked, then the parameter burst fails */
+  CHECK(clockgen.beginTransaction(true) == ERROR_NONE);
+  clockgen.setupPLLInt(SI5351_PLL_A, 32);
+  clockgen.setupMultisynth(0, SI5351_PLL_A, 40, 0, 1);
+  mockFailAfter = 2;
+  CHECK(clockgen.commit() == ERROR_I2C_TRANSACTION);
+  CHECK(mockRegs[SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL] == 0xFF);
+
+  /* The lost registers are rewritten, and the outputs come back */
+  mockLog.clear();
+  CHECK(clockgen.setupMultisynth(0, SI5351_PLL_A, 40, 0, 1) == ERROR_NONE);
+  CHECK(mockWrites() > 0);
+  CHECK(clockgen.enableOutputs(true) == ERROR_NONE);
+  CHECK(mockRegs[SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL] == 0x00);
+
+  /* A map inside a transaction is staged, not lost */
+  static const uint8_t map[] = {16, 1, 0x4F, SI5351_MAP_END};
+  mockRegs[16] = 0x80;
+  clockgen.syncFromDevice();
+  CHECK(clockgen.beginTransaction(false) == ERROR_NONE);
+  CHECK(clockgen.loadRegisterMap(map) == ERROR_NONE);
+  CHECK(clockgen.commit() == ERROR_NONE);
+  CHECK(mockRegs[16] == 0x4F);
+}
+
+int main(void) {
+  testBatching();
+  testFailedCommit();
+
+  return testResult("test_commit");
+}
@@ -0,0 +1,56 @@
+/*
+ * @file test_encode.cpp
+ *
+ * encodeDivider() against exact rational math: every 20-bit denominator
+ * with its edge numerators, plus random dividers, must give the P1/P2/P3
+ * of AN619 and encode exactly a + b / c.
+ */
+
+#include <random>
+
+#include "test.h"
+
+static uint32_t failures = 0;
+
+/*
+ * Decodes regs by the AN619 layout and checks it against a + b / c
+ */
+static void check(uint32_t a, uint32_t b, uint32_t c) {
+  uint8_t regs[8];
+  Adafruit_SI5351::encodeDivider(a, b, c, regs);
+
+  uint64_t P1 = ((uint64_t)(regs[2] & 0x03) << 16) | (regs[3] << 8) | regs[4];
+  uint64_t P2 = ((uint64_t)(regs[5] & 0x0F) << 16) | (regs[6] << 8) | regs[7];
+  uint64_t P3 = ((uint64_t)(regs[5] >> 4) << 16) | (regs[0] << 8) | regs[1];
+  uint64_t f = (128ULL * b) / c; /* floor(128 * b / c) */
+
+  /* AN619 equations, then (P1 + 512 + P2 / P3) / 128 == a + b / c */
+  bool ok = (P1 == 128ULL * a + f - 512) && (P2 == 128ULL * b - c * f) &&
+            (P3 == c) && (P2 < P3) && ((regs[2] & 0xFC) == 0) &&
+            ((P1 + 512) * P3 + P2 == 128ULL * ((uint64_t)a * c + b));
+  if (!ok && (failures++ < 10))
+    printf("encodeDivider(%u, %u, %u) is wrong\n", (unsigned)a, (unsigned)b,
+           (unsigned)c);
+}
+
+int main(void) {
+  std::mt19937 rng(4);
+
+  /* Every denominator, with the numerators at both ends and between */
+  for (uint32_t c = 1; c <= 0xFFFFF; c++) {
+    check(8, 0, c);
+    check(2048, c - 1, c);
+    check(15 + c % 76, c / 2, c);
+    check(4 + c % 2045, rng() % c, c);
+  }
+
+  /* Random PLL and multisynth dividers over the full range */
+  for (uint32_t i = 0; i < 4000000; i++) {
+    uint32_t c = 1 + rng() % 0xFFFFF;
+    uint32_t a = (i & 1) ? 15 + rng() % 76 : 8 + rng() % 2041;
+    check(a, rng() % c, c);
+  }
+
+  CHECK(failures == 0);
+  return testResult("test_encode");
+}
@@ -0,0 +1,65 @@
+/*
+ * @file test_fbint.cpp
+ *
+ * FBA_INT makes PLL A ignore P2. setupPLLInt() leaves it alone, but a
+ * register map or an earlier firmware may have set it for an integer
+ * PLL, so anything that moves the PLL by its fraction alone must clear
+ * it first.
+ */
+
+#include "test.h"
+
+/*!
+ * @brief Sets PLL A up as an integer PLL with FBA_INT set on the device
+ */
+static void setupIntegerPLL(Adafruit_SI5351 *clockgen) {
+  CHECK(clockgen->setupPLLInt(SI5351_PLL_A, 36) == ERROR_NONE);
+  mockRegs[SI5351_REGISTER_22_CLK6_CONTROL] |= 1 << 6;
+  CHECK(clockgen->syncFromDevice() == ERROR_NONE);
+}
+
+/*!
+ * @return The CLK0 frequency the device registers give, in mHz
+ */
+static uint64_t deviceFrequency(Adafruit_SI5351 *clockgen) {
+  uint64_t freq = 0;
+
+  CHECK(clockgen->syncFromDevice() == ERROR_NONE);
+  CHECK(clockgen->getOutputFrequency(0, &freq) == ERROR_NONE);
+  return freq;
+}
+
+int main(void) {
+  const uint8_t fbaInt = 1 << 6;
+  Adafruit_SI5351 clockgen;
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+
+  /* Sweep */
+  setupIntegerPLL(&clockgen);
+  CHECK(clockgen.startSweep(0, 10000000000ULL, 10010000000ULL, 10, 0) ==
+        ERROR_NONE);
+  CHECK(!(mockRegs[SI5351_REGISTER_22_CLK6_CONTROL] & fbaInt));
+  uint64_t first = deviceFrequency(&clockgen);
+  CHECK(clockgen.sweepStep() == ERROR_NONE);
+  uint64_t second = deviceFrequency(&clockgen);
+  CHECK((second > first + 999990) && (second < first + 1000010));
+
+  /* Tone table in PLL mode */
+  const uint64_t freqs[] = {10000000000ULL, 10000010000ULL};
+  si5351ToneTable_t table;
+  si5351Tone_t tones[2];
+  CHECK(clockgen.setupMultisynth(0, SI5351_PLL_A, 88, 0, 1) == ERROR_NONE);
+  setupIntegerPLL(&clockgen);
+  CHECK(clockgen.buildToneTable(&table, tones, 2, 0, freqs,
+                                SI5351_TONE_PLL) == ERROR_NONE);
+  CHECK(!(mockRegs[SI5351_REGISTER_22_CLK6_CONTROL] & fbaInt));
+  CHECK(clockgen.selectTone(&table, 0) == ERROR_NONE);
+  first = deviceFrequency(&clockgen);
+  CHECK(clockgen.selectTone(&table, 1) == ERROR_NONE);
+  second = deviceFrequency(&clockgen);
+  CHECK((second > first + 9700) && (second < first + 10300));
+
+  return testResult("test_fbint");
+}
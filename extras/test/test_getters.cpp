@@ -0,0 +1,64 @@
+/*
+ * @file test_getters.cpp
+ *
+ * getPLLFrequency() and getOutputFrequency() must read back exactly what
+ * fineTunePLL() programmed, and setFrequency() must solve from that VCO
+ * rather than from the multiplier rounded to a 20-bit fraction.
+ */
+
+#include "test.h"
+
+/*!
+ * @return The PLL A VCO in mHz, to the nearest mHz, worked out from the
+ *         mock registers in floating point
+ */
+static uint64_t mockVCO(void) {
+  const uint8_t *r = &mockRegs[26];
+  uint32_t P3 = ((uint32_t)(r[5] >> 4) << 16) | (r[0] << 8) | r[1];
+  uint32_t P1 = ((uint32_t)(r[2] & 0x03) << 16) | (r[3] << 8) | r[4];
+  uint32_t P2 = ((uint32_t)(r[5] & 0x0F) << 16) | (r[6] << 8) | r[7];
+  long double X = (long double)(P1 + 512) * P3 + P2;
+
+  return (uint64_t)(25000000000.0L * X / (128.0L * P3) + 0.5L);
+}
+
+static uint64_t distance(uint64_t x, uint64_t y) {
+  return (x > y) ? x - y : y - x;
+}
+
+int main(void) {
+  const int32_t ppbs[] = {1, -1, 7, -26, 26, 100, -1000, 123457, -2500000};
+  const uint64_t nominal = 900000000000ULL; /* 36 * 25MHz, in mHz */
+  Adafruit_SI5351 clockgen;
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+  CHECK(clockgen.setupPLL(SI5351_PLL_A, 36, 0, 1) == ERROR_NONE);
+  CHECK(clockgen.setupMultisynthInt(0, SI5351_PLL_A,
+                                    SI5351_MULTISYNTH_DIV_6) == ERROR_NONE);
+
+  for (size_t i = 0; i < sizeof(ppbs) / sizeof(ppbs[0]); i++) {
+    uint64_t vco, fout;
+
+    CHECK(clockgen.fineTunePLL(SI5351_PLL_A, ppbs[i]) == ERROR_NONE);
+    CHECK(clockgen.getPLLFrequency(SI5351_PLL_A, &vco) == ERROR_NONE);
+    CHECK(distance(vco, mockVCO()) <= 1);
+
+    /* X moves in steps of about 0.2ppb */
+    int64_t want = (int64_t)nominal + 900 * (int64_t)ppbs[i];
+    CHECK(distance(vco, want) <= nominal / 5000000000ULL);
+
+    CHECK(clockgen.getOutputFrequency(0, &fout) == ERROR_NONE);
+    CHECK(distance(fout, (mockVCO() + 3) / 6) <= 1);
+
+    /* A retune on the tuned PLL solves from its exact VCO, so the error
+       it reports is the one the getter sees */
+    int64_t error;
+    CHECK(clockgen.setFrequency(1, 10000000000ULL, SI5351_PLL_A, &error) ==
+          ERROR_NONE);
+    CHECK(clockgen.getOutputFrequency(1, &fout) == ERROR_NONE);
+    CHECK(distance(fout, 10000000000ULL + error) <= 1);
+  }
+
+  return testResult("test_getters");
+}
@@ -0,0 +1,28 @@
+/*
+ * @file test_lock.cpp
+ *
+ * enableLockInterrupt() must unmask only LOL_A and LOL_B in register 2,
+ * and mask them again when the pin is released.
+ */
+
+#include "test.h"
+
+int main(void) {
+  Adafruit_SI5351 clockgen;
+  const uint8_t lol = SI5351_STATUS_LOL_A | SI5351_STATUS_LOL_B;
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+
+  /* Everything starts unmasked */
+  mockRegs[SI5351_REGISTER_2_INTERRUPT_STATUS_MASK] = 0x00;
+  clockgen.syncFromDevice();
+  CHECK(clockgen.enableLockInterrupt(2) == ERROR_NONE);
+  CHECK((mockRegs[SI5351_REGISTER_2_INTERRUPT_STATUS_MASK] & 0xF8) ==
+        (0xF8 & ~lol));
+
+  CHECK(clockgen.enableLockInterrupt(-1) == ERROR_NONE);
+  CHECK((mockRegs[SI5351_REGISTER_2_INTERRUPT_STATUS_MASK] & 0xF8) == 0xF8);
+
+  return testResult("test_lock");
+}
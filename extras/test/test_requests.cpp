@@ -0,0 +1,35 @@
+/*
+ * @file test_requests.cpp
+ *
+ * With async writes on, a request on every loop() must not starve the
+ * write queue: poll() has to get traffic on the bus, and the last
+ * request has to reach the device once the requests stop.
+ */
+
+#include "test.h"
+
+int main(void) {
+  const uint64_t base = 10000000000ULL; /* 10MHz */
+  Adafruit_SI5351 clockgen;
+  uint64_t freq = 0;
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+  CHECK(clockgen.enableAsyncWrites(true) == ERROR_NONE);
+
+  uint32_t writes = mockWrites();
+  for (uint32_t i = 0; i < 200; i++) {
+    CHECK(clockgen.requestFrequency(0, base + i * 1000000ULL) == ERROR_NONE);
+    CHECK(clockgen.poll() == ERROR_NONE);
+  }
+  CHECK(mockWrites() > writes);
+
+  /* Drain the rest, then read the device back */
+  for (uint32_t i = 0; i < 100; i++)
+    CHECK(clockgen.poll() == ERROR_NONE);
+  CHECK(clockgen.syncFromDevice() == ERROR_NONE);
+  CHECK(clockgen.getOutputFrequency(0, &freq) == ERROR_NONE);
+  CHECK(freq == base + 199 * 1000000ULL);
+
+  return testResult("test_requests");
+}
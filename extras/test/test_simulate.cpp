@@ -0,0 +1,140 @@
+/*
+ * @file test_simulate.cpp
+ *
+ * decodeRegisterImage() as the correctness oracle: random setFrequency()
+ * calls and planFrequencies() plans are decoded back from the register
+ * image the mock received, and must be flag free and land where the
+ * solver said they would. Broken images must be flagged.
+ */
+
+#include <chrono>
+#include <random>
+
+#include "test.h"
+
+#define XTAL_HZ 25000000 //!< The breakout's crystal
+
+static int64_t distance(uint64_t a, uint64_t b) {
+  return (a > b) ? a - b : b - a;
+}
+
+/*
+ * The decoded output must be the requested frequency plus the error the
+ * solver reported, within the decoder's rounding to the nearest mHz
+ */
+static bool landed(const si5351RegisterImage_t *image, uint8_t output,
+                   uint64_t freq_milliHz, int64_t error_milliHz) {
+  const si5351OutputImage_t *out = &image->out[output];
+  return out->poweredUp && (out->flags == 0) &&
+         (distance(out->freq_milliHz, freq_milliHz + error_milliHz) <= 1);
+}
+
+static void testSetFrequency(void) {
+  Adafruit_SI5351 clockgen;
+  si5351RegisterImage_t image;
+  std::mt19937_64 rng(16);
+  uint32_t bad = 0;
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+  for (uint32_t i = 0; i < 100000; i++) {
+    uint8_t output = rng() % 8;
+    uint64_t max = (output >= 6) ? 150000000000ULL : 200000000000ULL;
+    uint64_t freq = 20000000ULL + rng() % (max - 20000000ULL);
+    si5351PLL_t pll = (rng() & 1) ? SI5351_PLL_A : SI5351_PLL_B;
+    int64_t error;
+
+    if (clockgen.setFrequency(output, freq, pll, &error) != ERROR_NONE) {
+      bad++;
+      continue;
+    }
+    /* Other outputs on a PLL that moved may have gone out of range, so
+       only this output and its PLL are checked */
+    Adafruit_SI5351::decodeRegisterImage(mockRegs, XTAL_HZ, &image);
+    if (image.pllFlags[pll] || !landed(&image, output, freq, error)) {
+      if (bad++ < 10)
+        printf("CLK%u at %llu mHz: decoded %llu mHz\n", (unsigned)output,
+               (unsigned long long)freq,
+               (unsigned long long)image.out[output].freq_milliHz);
+    }
+  }
+  CHECK(bad == 0);
+}
+
+static void testPlans(void) {
+  Adafruit_SI5351 clockgen;
+  si5351OutputRequest_t requests[8];
+  si5351FrequencyPlan_t plan;
+  si5351RegisterImage_t image;
+  std::mt19937_64 rng(25);
+  uint32_t planned = 0, bad = 0;
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+  for (uint32_t i = 0; i < 2000; i++) {
+    memset(requests, 0, sizeof(requests));
+    for (uint8_t n = 0; n < 3; n++) {
+      requests[n].freq_milliHz = 1000000ULL + rng() % 150000000000ULL;
+      requests[n].tolerance_milliHz = 1000;
+    }
+    if (clockgen.planFrequencies(requests, &plan) != ERROR_NONE)
+      continue;
+    planned++;
+    CHECK(clockgen.setFrequencies(&plan) == ERROR_NONE);
+    Adafruit_SI5351::decodeRegisterImage(mockRegs, XTAL_HZ, &image);
+    for (uint8_t n = 0; n < 3; n++) {
+      int64_t error = plan.out[n].error_milliHz;
+      if (image.flags || !landed(&image, n, requests[n].freq_milliHz, error))
+        bad++;
+    }
+  }
+  printf("plans: %u of 2000 planned\n", (unsigned)planned);
+  CHECK(planned > 1000);
+  CHECK(bad == 0);
+}
+
+static void testFlags(void) {
+  Adafruit_SI5351 clockgen;
+  si5351RegisterImage_t image;
+  uint8_t regs[256];
+
+  mockReset();
+  CHECK(clockgen.begin() == ERROR_NONE);
+  CHECK(clockgen.setFrequency(0, 10000000000ULL) == ERROR_NONE);
+  memcpy(regs, mockRegs, sizeof(regs));
+  CHECK(Adafruit_SI5351::decodeRegisterImage(regs, XTAL_HZ, &image) == 0);
+
+  /* PLL A at 15 + 0/1: 375MHz, below the VCO range */
+  Adafruit_SI5351::encodeDivider(15, 0, 1, &regs[26]);
+  CHECK(Adafruit_SI5351::decodeRegisterImage(regs, XTAL_HZ, &image) &
+        SI5351_IMAGE_VCO_RANGE);
+
+  /* MS0 at 5, which only exists as 4 or 6 */
+  memcpy(regs, mockRegs, sizeof(regs));
+  Adafruit_SI5351::encodeDivider(5, 0, 1, &regs[42]);
+  CHECK(Adafruit_SI5351::decodeRegisterImage(regs, XTAL_HZ, &image) &
+        SI5351_IMAGE_DIVIDER_RANGE);
+}
+
+static void testThroughput(void) {
+  typedef std::chrono::steady_clock clock;
+  si5351RegisterImage_t image;
+  volatile uint64_t sink = 0;
+
+  clock::time_point start = clock::now();
+  for (uint32_t i = 0; i < 1000000; i++) {
+    Adafruit_SI5351::decodeRegisterImage(mockRegs, XTAL_HZ, &image);
+    sink += image.out[i & 7].freq_milliHz;
+  }
+  double s = std::chrono::duration<double>(clock::now() - start).count();
+  printf("decodeRegisterImage(): %.1fM images/s\n", 1.0 / s);
+}
+
+int main(void) {
+  testSetFrequency();
+  testPlans();
+  testFlags();
+  testThroughput();
+
+  return testResult("test_simulate");
+}